@@ -1,6 +1,14 @@
 `default_nettype none
+`include "rom_words.vh" // written with main.hex by GBA/main.sh
 
-module top(
+module top #(
+  // 0: din carries two bits per wclk (nRF toggling the pins in software)
+  // 1: din[1] carries one bit per wclk (nRF using SPIM, built with LINK_SPIM)
+  parameter SERIAL_LINK = 0,
+  // halfwords in main.hex, the GBA program, at most 2048 (the sound window
+  // starts at 0x0800)
+  parameter ROM_WORDS = `ROM_WORDS
+)(
   input wire clk,
   input wire GBACART_CS,
   input wire GBACART_RD,
@@ -11,65 +19,705 @@ module top(
   input wire wclk,
   input wire write_en,
 
-  output reg [5:0] buttons
+  output reg [5:0] buttons = 6'd0,
+  output wire link_error // a frame failed its check since the last whole bank
+                         // was written, or the button events after CMD_EVENTS
 );
 
-reg  [15:0] gba_data_out;
+// There is no reset: every register and RAM here starts at 0, as the iCE40's
+// flip-flops and block RAM do once it is configured.
+integer init_i;
+
+reg  [15:0] gba_data_out = 16'd0;
 wire [15:0] gba_addr_lo_in;
-reg  [15:0] gba_addr_lo;
+reg  [15:0] gba_addr_lo = 16'd0;
+reg  [15:0] fetch_addr = 16'd0; // halfword being fetched, gba_addr_lo or the one after
+reg         ahead = 1'b0;       // fetch_addr is a halfword ahead of gba_addr_lo
+reg         fetch_wait = 1'b0;  // fetch_addr was loaded last clk, read_data isn't ready
+reg         rd_low = 1'b0;      // RD has fallen since CS did
 //wire [23:0] gba_addr;
 //assign gba_addr = {GBACART_AH, gba_addr_lo};
 
-reg [15:0] rom [0:609];
+reg [15:0] rom [0:ROM_WORDS-1];
+reg [15:0] rom_word = 16'd0; // rom at fetch_addr, a clk later
 initial $readmemh("main.hex", rom);
 
-reg  [1:0] vram [0:19200];
-reg [14:0] waddr;
-wire [1:0] dout;
-assign dout = vram[gba_addr_lo[14:0]];
+// Three banks of the 128x64 image, sixteen pixels to a word with the leftmost
+// in bit 15. The nRF writes in to one bank while the GBA reads another, and
+// CMD_FLIP, once the CMD_CHECK after it passes, marks a bank as the latest
+// complete frame. The GBA reads it either as a 240 pixel wide mode 4 bitmap
+// from 0x8000, two pixels to each halfword and anything outside the image
+// black, or as 128 4bpp tiles from 0x4000, sixteen across and eight down, four
+// pixels to each halfword.
+//
+// 0xC000 is the same bitmap for racing the beam, a line at a time. Where a
+// read from 0x8000 or 0x4000 keeps to one bank until the next frame, every
+// read from 0xC000 takes the latest bank, so each line is as new as it can be.
+//
+// vram is written from the clk domain: words received on the link are handed
+// over with a toggle, and CMD_FILL runs a fill of a whole bank at one word
+// per clk. The ROM, vram and the PCM FIFO are each read a clk after their
+// address is set, so they go in block RAM with one read and one write port.
+reg [15:0] vram [0:1535];
+initial for (init_i = 0; init_i < 1536; init_i = init_i + 1) vram[init_i] = 16'h0000;
+reg [10:0] waddr = 11'd0;    // {bank, word}
+reg  [1:0] shown_bank = 2'd0; // last bank flipped by the nRF
+reg  [1:0] read_bank = 2'd0; // bank the GBA is reading, taken at the start of a frame or line
+reg  [1:0] display_mode = 2'd0; // {all pixels on, invert}, applied as the GBA reads
+reg  [6:0] rd_row = 7'd0; // row of the framebuffer read address, 64 and above is outside
+reg  [6:0] rd_col = 7'd0; // halfword column, 0 - 119, 64 and above is outside
+reg  [6:0] fetch_row = 7'd0; // rd_row and rd_col for fetch_addr
+reg  [6:0] fetch_col = 7'd0;
+wire [10:0] vram_raddr;
+reg  [15:0] vram_word = 16'd0; // vram at vram_raddr, a clk later
+wire  [1:0] dout;
+wire        tile_read;  // reading the tile window
+wire  [1:0] tile_quad;  // which four pixels of the word
+wire  [3:0] tile_dout;
+assign tile_read = (fetch_addr[15:11] == 5'b01000);
+// tile window halfword: {tile row, tile column, pixel row, half of the row}
+assign tile_quad = {fetch_addr[4], fetch_addr[0]};
+assign vram_raddr = tile_read ? {read_bank, fetch_addr[10:8], fetch_addr[3:1], fetch_addr[7:5]}
+                              : {read_bank, fetch_row[5:0], fetch_col[5:3]};
+assign dout = vram_word[{~fetch_col[2:0], 1'b1} -: 2];
+assign tile_dout = vram_word[{~tile_quad, 2'b11} -: 4] ^ {4{resyncMode3[0]}} | {4{resyncMode3[1]}};
+
+// split the framebuffer halfword offset being loaded in to row and column
+// (offset / 120) without a divider: offset = hi * 128 + lo = hi * 120 + v.
+// Bit 14 is left out so 0xC000 maps the same as 0x8000.
+wire [7:0] ld_hi;
+wire [9:0] ld_v;
+wire [2:0] ld_k;
+wire [9:0] ld_col;
+wire [6:0] ld_row;
+assign ld_hi  = {1'b0, gba_addr_lo_in[13:7]};
+assign ld_v   = {ld_hi[6:0], 3'b000} + gba_addr_lo_in[6:0];
+assign ld_k   = (ld_v >= 10'd480) ? 3'd4 :
+                (ld_v >= 10'd360) ? 3'd3 :
+                (ld_v >= 10'd240) ? 3'd2 :
+                (ld_v >= 10'd120) ? 3'd1 : 3'd0;
+assign ld_col = ld_v - ld_k * 7'd120;
+assign ld_row = (ld_hi >= 8'd60) ? 7'd64 : ld_hi[5:0] + ld_k;
+
+reg [15:0] sound = 16'd0;
+
+// The GBA's four PSG channels (square 1, square 2, wave, noise), each read at
+// 0x0C10 + channel * 4 as {voice, note, count of notes}. The GBA sets a
+// channel up again whenever its count changes.
+reg [15:0] psg_voice [0:3];
+reg [15:0] psg_note  [0:3];
+reg  [3:0] psg_count [0:3];
+initial
+  for (init_i = 0; init_i < 4; init_i = init_i + 1)
+    begin
+      psg_voice[init_i] = 16'h0000;
+      psg_note[init_i]  = 16'h0000;
+      psg_count[init_i] = 4'h0;
+    end
+
+// PCM samples for the GBA's Direct Sound A, 8 bit signed. They arrive after
+// CMD_PCM as link data, are handed to the clk domain two at a time with a
+// toggle, and wait in a FIFO of 512 halfwords. Each halfword read from 0x2000
+// - 0x2FFF takes the next two, the first in the low byte as the GBA plays
+// them, or silence when the FIFO is empty. The next halfword of a burst,
+// fetched ahead, is the pair after pcm_rd and silence unless two are waiting.
+// Samples arriving when it's full are dropped. The level, in 32 sample units,
+// goes back to the nRF in the button events header.
+reg [15:0] pcm_fifo [0:511];
+initial for (init_i = 0; init_i < 512; init_i = init_i + 1) pcm_fifo[init_i] = 16'h0000;
+reg [15:0] pcm_word = 16'd0; // pcm_fifo at pcm_rd (+ 1 when ahead), a clk later
+reg  [9:0] pcm_wr = 10'd0; // halfwords added (index and a wrap bit)
+reg  [9:0] pcm_rd = 10'd0; // halfwords read
+wire [9:0] pcm_level;
+wire [4:0] pcm_report;
+wire       pcm_window;
+wire       pcm_fetch;  // fetch_addr in the PCM window
+reg  [4:0] pcm_report_gray = 5'd0; // for the link's clock domain
+reg [15:0] pcm_data = 16'd0;       // from the link, to the clk domain
+reg        pcm_toggle = 1'b0;
+assign pcm_level  = pcm_wr - pcm_rd;
+assign pcm_report = pcm_level[9] ? 5'd31 : pcm_level[8:4];
+assign pcm_window = (gba_addr_lo[15:12] == 4'h2);
+assign pcm_fetch  = (fetch_addr[15:12] == 4'h2);
+
+// nRF52840 link
+//
+// The link carries two bit symbols. In serial mode two clocks make up one
+// symbol, the first bit being the more significant, and the pairing restarts
+// whenever write_en changes.
+//
+// write_en HIGH : symbols are collected in to 16 pixel words, each written to
+//                 vram[waddr] as it completes, then waddr increments.
+//                 After CMD_DELTA the words come in runs, each after a 4
+//                 symbol header: 0nnnnnnn skips n + 1 words, 1nnnnnnn is
+//                 followed by n + 1 words.
+// write_en LOW  : each symbol is shifted in to the command register (din[1] is
+//                 the more significant bit). After 12 symbols the 24 bit word
+//                 is executed as an 8 bit opcode followed by a 16 bit argument.
+//                 Any clock with write_en HIGH realigns the command framing.
+localparam CMD_SOUND = 8'h00; // upper 4 bits volume / mute, lower 11 bits frequency
+localparam CMD_ADDR  = 8'h01; // {bank, word} vram address for the following data
+localparam CMD_FLIP  = 8'h02; // bits 1:0 bank now holding a complete frame,
+                              // bit 2 whole bank written, bits 15:8 frame number,
+                              // acted on by the CMD_CHECK that follows
+localparam CMD_FILL  = 8'h03; // bits 1:0 bank, bit 8 value for every pixel
+localparam CMD_MODE  = 8'h04; // bit 0 invert, bit 1 all pixels on
+localparam CMD_DELTA = 8'h05; // {bank, word} vram address for a delta stream
+localparam CMD_CHECK = 8'h06; // check of the bytes since the last check
+localparam CMD_EVENTS = 8'h07; // the data clocks that follow read the button events
+localparam CMD_PCM   = 8'h08; // the data that follows is PCM samples
+localparam CMD_VOICE = 6'b000100; // 0x10 - 0x13, PSG channel in bits 1:0:
+                                  // duty and envelope, as SOUND1CNT_H
+localparam CMD_NOTE  = 6'b000101; // 0x14 - 0x17: frequency and reset, as
+                                  // SOUND1CNT_X
+
+// Every byte, command or data, is added in to a Fletcher style check,
+// {sum of sums, sum}, which is taken as the CMD_CHECK opcode arrives and
+// compared with its argument. CMD_FLIP comes just before it, so a bad bank,
+// whole bit or frame number fails the check as well. A frame that fails, or
+// has no CMD_FLIP, isn't flipped to, and link_error is held HIGH until a good
+// frame writes a whole bank; until then frames of changes alone are refused
+// too, as they build on an image the nRF can no longer be sure of. So
+// link_error after a check says whether the flip was refused. Words and fills
+// for the bank being shown are dropped: the nRF never sends them, and a bad
+// address mustn't tear the image on screen before the check can refuse the
+// frame. The counters can be read by the GBA at 0x0C00 - 0x0C02, and the
+// latency of the last frame at 0x0C03.
+reg  [7:0] check_a = 8'd0;
+reg  [7:0] check_b = 8'd0;
+reg [15:0] check_taken = 16'd0;
+wire       check_valid;
+wire [7:0] check_byte;
+wire [7:0] check_a_next;
+reg [15:0] flip_arg = 16'd0; // CMD_FLIP, acted on by CMD_CHECK
+reg        flip_pending = 1'b0;
+wire       check_good;  // a CMD_FLIP, and the check passes
+wire [7:0] frame_skip;  // frame numbers skipped, as a good check arrives
+reg  [7:0] next_frame = 8'd0;   // frame number expected in the next flip
+reg [15:0] good_frames = 16'd0;
+reg [15:0] bad_frames = 16'd0;
+reg [15:0] lost_frames = 16'd0; // frame numbers skipped
+reg        stat_toggle = 1'b0;
+reg        frame_error = 1'b0;  // driven on link_error
+
+// Button samples
+//
+// The GBA samples its keys from a timer interrupt, about 1000 times a second,
+// and reads 0x1000 | {time, buttons}, the time being a 6 bit count of its
+// samples and the buttons active LOW {down, up, left, right, B, A}. buttons
+// follows every sample, and each change is added to a ring of events.
+//
+// Older GBA programs, main.hex among them until it is rebuilt from main.c,
+// read the sound word at 0x0800 + keys instead, keys being KEYINPUT bits
+// {7:4, 1:0}. buttons follows those reads until the first 0x1000 sample.
+// Offset 0 (every key down) is where main.c reads the sound word, so it is
+// never taken as keys.
+//
+// After CMD_EVENTS the nRF clocks data with write_en HIGH, which isn't
+// written, and reads link_error as each wclk rises. It carries 192 bits,
+// most significant first, changing as wclk falls: a header
+// {count, overflow, PCM FIFO level, time of the latest sample} then count
+// (at most 8) events {4'b0, time, buttons}, oldest first, zeros up to the
+// ninth, and the frame counters good_frames, bad_frames and lost_frames.
+// overflow is set if there were more than 8 events since the last
+// CMD_EVENTS, only the latest being sent. The count of events waiting stops
+// at 63, further changes replacing the latest event, so the buttons after
+// the last event sent are always the current ones.
+function [5:0] gray_to_binary;
+  input [5:0] gray;
+  integer i;
+  begin
+    gray_to_binary[5] = gray[5];
+    for (i = 4; i >= 0; i = i - 1)
+      gray_to_binary[i] = gray_to_binary[i + 1] ^ gray[i];
+  end
+endfunction
+
+reg [11:0] event_ring [0:15];
+initial for (init_i = 0; init_i < 16; init_i = init_i + 1) event_ring[init_i] = 12'h000;
+reg  [5:0] sample_buttons = 6'd0; // at the last sample
+reg  [5:0] event_wr = 6'd0;       // events added (ring index and wrap bits)
+reg  [5:0] event_wr_gray = 6'd0;  // gray coded for the link's clock domain
+reg  [5:0] event_rd1 = 6'd0, event_rd2 = 6'd0; // events_rd, synchronised to clk
+reg  [5:0] event_rd = 6'd0;       // event_rd2 once steady, as it jumps at CMD_EVENTS
+wire [5:0] event_waiting;
+assign event_waiting = event_wr - event_rd;
+reg  [5:0] sample_time_gray = 6'd0;
+reg        timed_samples = 1'b0; // a 0x1000 sample was seen, ignore 0x0800 + keys
+
+reg  [5:0] events_wr1 = 6'd0, events_wr2 = 6'd0; // event_wr_gray, synchronised to wclk
+reg  [5:0] events_now1 = 6'd0, events_now2 = 6'd0; // sample_time_gray, synchronised to wclk
+reg  [4:0] events_pcm1 = 5'd0, events_pcm2 = 5'd0; // pcm_report_gray, synchronised to wclk
+reg  [5:0] events_rd = 6'd0;    // events already sent
+reg  [5:0] events_first = 6'd0; // first event being sent
+reg  [3:0] events_count = 4'd0;
+reg        events_overflow = 1'b0;
+reg        events_out = 1'b0;   // sending the events on link_error
+reg  [7:0] events_bit = 8'd0;   // bit being sent
+reg        events_pin = 1'b0;
+wire [5:0] events_wr_bin;
+wire [5:0] events_now_bin;
+wire [5:0] events_pcm_bin;
+wire [5:0] events_pending;
+wire [3:0] events_word;
+wire [3:0] events_ring_addr;
+wire [15:0] events_data;
+assign events_wr_bin    = gray_to_binary(events_wr2);
+assign events_now_bin   = gray_to_binary(events_now2);
+assign events_pcm_bin   = gray_to_binary({1'b0, events_pcm2});
+assign events_pending   = events_wr_bin - events_rd;
+assign events_word      = events_bit[7:4];
+assign events_ring_addr = events_first[3:0] + events_word - 1'b1;
+assign events_data = (events_word == 4'd0) ? {events_count, events_overflow, events_pcm_bin[4:0], events_now_bin} :
+                     (events_word <= events_count) ? {4'b0000, event_ring[events_ring_addr]} :
+                     (events_word == 4'd9) ? good_frames :
+                     (events_word == 4'd10) ? bad_frames :
+                     (events_word == 4'd11) ? lost_frames : 16'h0000;
+assign link_error  = events_out ? events_pin : frame_error;
 
-reg [15:0] sound;
-reg [15:0] sound_temp;
+always @(negedge wclk)
+  events_pin <= events_data[~events_bit[3:0]];
+
+reg        write_en_q = 1'b0;
+reg        half = 1'b0; // serial mode: first bit of a symbol received
+reg        half_bit = 1'b0;
+wire       restart;
+wire [1:0] symbol;
+wire       symbol_valid;
+assign restart      = (write_en != write_en_q);
+assign symbol       = SERIAL_LINK ? {half_bit, din[1]} : din;
+assign symbol_valid = SERIAL_LINK ? (half && !restart) : 1'b1;
 
 always @(posedge wclk)
 begin
+  write_en_q <= write_en;
+  half_bit <= din[1];
+  half <= restart ? 1'b1 : !half;
+end
+
+reg  [13:0] pixels = 14'd0; // symbols of the word being received
+reg   [2:0] pixel_count = 3'd0;
+reg         delta = 1'b0;   // data is in runs
+reg         literal = 1'b0; // in a run of words, otherwise waiting for a header
+reg         pcm = 1'b0;     // data is PCM samples
+reg   [6:0] run = 7'd0;     // words left in the run, less one
+
+reg  [10:0] wr_addr = 11'd0; // last word received, for the clk domain to write
+reg  [15:0] wr_data = 16'd0;
+reg         wr_toggle = 1'b0;
+reg   [1:0] fill_bank = 2'd0;
+reg         fill_value = 1'b0;
+reg         fill_toggle = 1'b0;
+
+reg  [21:0] cmd_shift = 22'd0;
+reg   [3:0] cmd_count = 4'd0;
+wire [23:0] cmd_word;
+assign cmd_word = {cmd_shift, symbol};
+assign check_valid  = symbol_valid && (write_en ? (pixel_count[1:0] == 2'd3)
+                                                 : (cmd_count[1:0] == 2'd3));
+assign check_byte   = write_en ? {pixels[5:0], symbol} : cmd_word[7:0];
+assign check_a_next = check_a + check_byte;
+assign check_good   = flip_pending && cmd_word[15:0] == check_taken;
+assign frame_skip   = flip_arg[15:8] - next_frame;
+
+always @(posedge wclk)
+begin
+  events_wr1 <= event_wr_gray;
+  events_wr2 <= events_wr1;
+  events_now1 <= sample_time_gray;
+  events_now2 <= events_now1;
+  events_pcm1 <= pcm_report_gray;
+  events_pcm2 <= events_pcm1;
+
+  if (check_valid)
+    begin
+      check_a <= check_a_next;
+      check_b <= check_b + check_a_next;
+    end
+
   if (write_en)
     begin
-      vram[waddr] <= din;
-      waddr <= waddr + 1'b1; // increment address
+      if (symbol_valid)
+        begin
+          pixels <= {pixels[11:0], symbol};
+          pixel_count <= pixel_count + 1'b1;
+
+          if (events_out)
+            begin
+              // clocks for the events, the data is dropped
+            end
+          else if (pcm)
+            begin
+              if (pixel_count == 3'd7)
+                begin
+                  pcm_data <= {pixels[5:0], symbol, pixels[13:6]}; // first sample low
+                  pcm_toggle <= !pcm_toggle;
+                end
+            end
+          else if (delta && !literal)
+            begin
+              if (pixel_count == 3'd3) // run header
+                begin
+                  pixel_count <= 3'd0;
+                  if (pixels[5])
+                    begin
+                      literal <= 1'b1;
+                      run <= {pixels[4:0], symbol};
+                    end
+                  else
+                    waddr <= waddr + {pixels[4:0], symbol} + 1'b1;
+                end
+            end
+          else if (pixel_count == 3'd7)
+            begin
+              wr_addr <= waddr;
+              wr_data <= {pixels, symbol};
+              if (waddr[10:9] != shown_bank) // only misaddressed data goes there
+                wr_toggle <= !wr_toggle;
+              waddr <= waddr + 1'b1; // increment address
 
-      sound <= sound_temp; // latch sound data
+              if (run == 7'd0) literal <= 1'b0;
+              else run <= run - 1'b1;
+            end
+        end
+
+      cmd_count <= 4'd0;
+      if (events_out && events_bit != 8'hFF) events_bit <= events_bit + 1'b1;
     end
-  else
+  else if (symbol_valid)
     begin
-      waddr <= 15'b000000000000000;
+      events_out <= 1'b0;
+
+      cmd_shift <= cmd_word[21:0]; // shift-left register
+
+      if (cmd_count == 4'd3 && cmd_word[7:0] == CMD_CHECK)
+        check_taken <= {check_b, check_a};
+
+      if (cmd_count == 4'd11)
+        begin
+          cmd_count <= 4'd0;
+
+          if (cmd_word[23:18] == CMD_VOICE)
+            psg_voice[cmd_word[17:16]] <= cmd_word[15:0];
+          if (cmd_word[23:18] == CMD_NOTE)
+            begin
+              psg_note[cmd_word[17:16]] <= cmd_word[15:0];
+              psg_count[cmd_word[17:16]] <= psg_count[cmd_word[17:16]] + 1'b1;
+            end
 
-      sound_temp <= {sound_temp[13:0], din}; // shift-left register
+          case (cmd_word[23:16])
+            CMD_SOUND: sound <= cmd_word[15:0]; // latch sound data
+            CMD_ADDR:
+              begin
+                waddr <= cmd_word[10:0];
+                pixel_count <= 3'd0;
+                delta <= 1'b0;
+                pcm <= 1'b0;
+              end
+            CMD_DELTA:
+              begin
+                waddr <= cmd_word[10:0];
+                pixel_count <= 3'd0;
+                delta <= 1'b1;
+                literal <= 1'b0;
+                pcm <= 1'b0;
+              end
+            CMD_PCM:
+              begin
+                pixel_count <= 3'd0;
+                pcm <= 1'b1;
+              end
+            CMD_FLIP:
+              begin
+                flip_arg <= cmd_word[15:0];
+                flip_pending <= 1'b1;
+              end
+            CMD_CHECK:
+              begin
+                if (check_good && (!frame_error || flip_arg[2]))
+                  begin
+                    shown_bank <= flip_arg[1:0];
+                    good_frames <= good_frames + 1'b1;
+                    frame_error <= 1'b0;
+                  end
+                else
+                  begin
+                    bad_frames <= bad_frames + 1'b1;
+                    frame_error <= 1'b1;
+                  end
+
+                // The number of a frame that fails its check can't be
+                // trusted. A frame can also fail twice, so a number behind is
+                // taken without counting.
+                if (!check_good)
+                  next_frame <= next_frame + 1'b1;
+                else
+                  begin
+                    if (!frame_skip[7])
+                      lost_frames <= lost_frames + frame_skip;
+                    next_frame <= flip_arg[15:8] + 1'b1;
+                  end
+
+                check_a <= 8'd0;
+                check_b <= 8'd0;
+                flip_pending <= 1'b0;
+                stat_toggle <= !stat_toggle;
+              end
+            CMD_FILL:
+              if (cmd_word[1:0] != shown_bank)
+                begin
+                  fill_bank <= cmd_word[1:0];
+                  fill_value <= cmd_word[8];
+                  fill_toggle <= !fill_toggle;
+                end
+            CMD_MODE:  display_mode <= cmd_word[1:0];
+            CMD_EVENTS:
+              begin
+                events_out <= 1'b1;
+                events_bit <= 8'd0;
+                pixel_count <= 3'd0;
+                events_rd <= events_wr_bin;
+                events_overflow <= (events_pending > 6'd8);
+                if (events_pending > 6'd8)
+                  begin
+                    events_count <= 4'd8;
+                    events_first <= events_wr_bin - 6'd8;
+                  end
+                else
+                  begin
+                    events_count <= events_pending[3:0];
+                    events_first <= events_rd;
+                  end
+              end
+          endcase
+        end
+      else
+        cmd_count <= cmd_count + 1'b1;
     end
 end
 
-reg risingRD, fallingRD, fallingCS;
-reg [1:3] resyncRD;
-reg [1:3] resyncCS;
+reg risingRD = 1'b0, fallingRD = 1'b0, fallingCS = 1'b0;
+reg [1:3] resyncRD = 3'd0;
+reg [1:3] resyncCS = 3'd0;
+reg [1:0] resyncBank1 = 2'd0, resyncBank2 = 2'd0, resyncBank3 = 2'd0;
+reg [1:0] resyncMode1 = 2'd0, resyncMode2 = 2'd0, resyncMode3 = 2'd0;
+reg [1:3] resyncWr = 3'd0;
+reg [1:3] resyncFill = 3'd0;
+reg [1:3] resyncPcm = 3'd0;
+
+reg [1:3] resyncStat = 3'd0;
+reg [15:0] stat_good = 16'd0, stat_bad = 16'd0, stat_lost = 16'd0;
+
+// Latency, in microseconds, from a flip reaching the clk domain to the GBA
+// first reading the middle row (32) of that frame. Frames replaced before
+// they are read aren't counted.
+localparam CLK_MHZ = 66;
+reg  [6:0] us_prescale = 7'd0;
+reg [15:0] latency_us = 16'd0;
+reg        latency_wait = 1'b0; // the latest bank hasn't been read yet
+reg  [1:0] resyncBank4 = 2'd0; // resyncBank3 a clk later, to see it change
+reg [15:0] stat_latency = 16'd0;
+
+reg        filling = 1'b0;
+reg [10:0] fill_addr = 11'd0;
+
+// the next row and column for fetch_addr
+wire [6:0] fetch_row_next;
+wire [6:0] fetch_col_next;
+assign fetch_row_next = (fetch_col == 7'd119 && !fetch_row[6]) ? fetch_row + 1'b1 : fetch_row;
+assign fetch_col_next = (fetch_col == 7'd119) ? 7'd0 : fetch_col + 1'b1;
+
+// vram's write port, taken by a word from the link ahead of a fill
+wire        word_arrived;
+wire        vram_we;
+wire [10:0] vram_waddr;
+wire [15:0] vram_wdata;
+assign word_arrived = (resyncWr[3] != resyncWr[2]);
+assign vram_we      = word_arrived || filling;
+assign vram_waddr   = word_arrived ? wr_addr : fill_addr;
+assign vram_wdata   = word_arrived ? wr_data : {16{fill_value}};
+
+// what the GBA reads at fetch_addr
+reg [15:0] read_data;
+
+always @*
+begin
+  if (fetch_addr < ROM_WORDS) read_data = rom_word;
+  else if (fetch_addr > 16'b0111_1111_1111_1111)
+    begin
+      if (fetch_row[6] || fetch_col[6]) read_data = 16'h0000; // border
+      else
+        begin
+          read_data[15:8] = (dout[0] ^ resyncMode3[0]) | resyncMode3[1] ? 8'hFF : 8'h00;
+          read_data[7:0]  = (dout[1] ^ resyncMode3[0]) | resyncMode3[1] ? 8'hFF : 8'h00;
+        end
+    end
+  else if (tile_read) // leftmost pixel in the lowest nibble, palette index 0 or 1
+    read_data = {3'b000, tile_dout[0], 3'b000, tile_dout[1],
+                 3'b000, tile_dout[2], 3'b000, tile_dout[3]};
+  else if (fetch_addr[15:2] == 14'h0300) // link counters
+    begin
+      case (fetch_addr[1:0])
+        2'd0: read_data = stat_good;
+        2'd1: read_data = stat_bad;
+        2'd2: read_data = stat_lost;
+        2'd3: read_data = stat_latency;
+      endcase
+    end
+  else if (fetch_addr[15:4] == 12'h0C1) // PSG channels
+    begin
+      case (fetch_addr[1:0])
+        2'd0: read_data = psg_voice[fetch_addr[3:2]];
+        2'd1: read_data = psg_note[fetch_addr[3:2]];
+        2'd2: read_data = {12'h000, psg_count[fetch_addr[3:2]]};
+        2'd3: read_data = 16'h0000;
+      endcase
+    end
+  else if (pcm_fetch)
+    read_data = (pcm_level <= {9'd0, ahead}) ? 16'h0000 : pcm_word;
+  else if (fetch_addr > 16'h7FF && fetch_addr < 16'hC00)
+    read_data = sound; // upper 4 bits volume / mute, lower 11 bits frequency
+  else
+    read_data = 16'h0000;
+end
 
 always @(posedge clk)
 begin
-  if (fallingRD)
+  // a word from the link is written as soon as its toggle arrives, and a
+  // fill carries on in the clks between them. wr_addr and wr_data are held
+  // for at least eight link clocks, well after the toggle has crossed.
+  if (vram_we)
+    vram[vram_waddr] <= vram_wdata;
+  if (filling && !word_arrived)
+    begin
+      fill_addr <= fill_addr + 1'b1;
+      if (fill_addr[8:0] == 9'h1FF) filling <= 1'b0;
+    end
+  vram_word <= vram[vram_raddr];
+  rom_word <= rom[fetch_addr[10:0]];
+
+  // two PCM samples from the link, and the GBA taking two as each read ends
+  if (resyncPcm[3] != resyncPcm[2] && pcm_level != 10'd512)
+    begin
+      pcm_fifo[pcm_wr[8:0]] <= pcm_data;
+      pcm_wr <= pcm_wr + 1'b1;
+    end
+  pcm_word <= pcm_fifo[pcm_rd[8:0] + ahead];
+  if (risingRD && pcm_window && pcm_level != 10'd0)
+    pcm_rd <= pcm_rd + 1'b1;
+  pcm_report_gray <= pcm_report ^ (pcm_report >> 1);
+
+  // the counters only change at a flip, with stat_toggle
+  if (resyncStat[3] != resyncStat[2])
+    begin
+      stat_good <= good_frames;
+      stat_bad  <= bad_frames;
+      stat_lost <= lost_frames;
+    end
+
+  if (resyncFill[3] != resyncFill[2])
+    begin
+      filling <= 1'b1;
+      fill_addr <= {fill_bank, 9'h000};
+    end
+
+  // For the first read of an access gba_data_out follows read_data, which is
+  // ready a clk after the address arrives, three to four clks (45 to 61ns)
+  // after CS falls. Only once RD is LOW and read_data is ready does fetch_addr
+  // move a halfword ahead, so an RD falling close behind CS still gets the
+  // right halfword, as long as it is held for the GBA's first access (at
+  // least three cycles, 179ns). The next halfword of the burst then waits in
+  // read_data until RD rises. It goes out on risingRD, about four clks (61ns)
+  // after the rise, while the one after that is fetched. That is within the
+  // GBA's 1 wait sequential reads (120ns), where without the prefetch it took
+  // seven clks (106ns), see WAITCNT_PROFILE in main.c.
+  if (!ahead || risingRD) gba_data_out <= read_data;
+
+  // time from each flip to the middle of that frame being read
+  if (us_prescale == CLK_MHZ - 1)
+    us_prescale <= 7'd0;
+  else
+    us_prescale <= us_prescale + 1'b1;
+
+  if (resyncBank3 != resyncBank4)
     begin
-      if (gba_addr_lo < 16'd610) gba_data_out = rom[gba_addr_lo[9:0]];
-      else if (gba_addr_lo > 16'b0111_1111_1111_1111)
+      latency_wait <= 1'b1;
+      latency_us <= 16'd0;
+      us_prescale <= 7'd0;
+    end
+  else if (latency_wait && fallingRD && gba_addr_lo[15] && rd_row == 7'd32 && read_bank == resyncBank3)
+    begin
+      latency_wait <= 1'b0;
+      stat_latency <= latency_us;
+    end
+  else if (latency_wait && us_prescale == CLK_MHZ - 1 && latency_us != 16'hFFFF)
+    latency_us <= latency_us + 1'b1;
+  resyncBank4 <= resyncBank3;
+
+  event_rd1 <= events_rd;
+  event_rd2 <= event_rd1;
+  if (event_rd2 == event_rd1) event_rd <= event_rd2;
+
+  // a button sample, encoded in to the address
+  if (fallingRD && gba_addr_lo[15:12] == 4'h1)
+    begin
+      timed_samples <= 1'b1;
+      buttons <= gba_addr_lo[5:0];
+      sample_buttons <= gba_addr_lo[5:0];
+      sample_time_gray <= gba_addr_lo[11:6] ^ {1'b0, gba_addr_lo[11:7]};
+
+      if (gba_addr_lo[5:0] != sample_buttons && event_waiting == 6'd63)
+        event_ring[event_wr[3:0] - 1'b1] <= gba_addr_lo[11:0]; // full
+      else if (gba_addr_lo[5:0] != sample_buttons)
         begin
-          gba_data_out[15:8] = (dout[0]) ? 8'hFF : 8'h00;
-          gba_data_out[7:0]  = (dout[1]) ? 8'hFF : 8'h00;
+          event_ring[event_wr[3:0]] <= gba_addr_lo[11:0];
+          event_wr <= event_wr + 1'b1;
+          event_wr_gray <= (event_wr + 1'b1) ^ ((event_wr + 1'b1) >> 1);
         end
-      else if (gba_addr_lo > 16'h7FF && gba_addr_lo < 16'hC00)
+    end
+  else if (fallingRD && !timed_samples && gba_addr_lo[15:10] == 6'b000010 && gba_addr_lo[9:0] != 10'd0)
+    buttons <= {gba_addr_lo[7:4], gba_addr_lo[1:0]}; // 0x0800 + keys
+
+  // fetch the next halfword once the first is out, and again as each read ends
+  fetch_wait <= 1'b0;
+  if ((rd_low && !fetch_wait && !ahead) || (risingRD && ahead))
+    begin
+      fetch_addr <= fetch_addr + 1'b1;
+      fetch_row <= fetch_row_next;
+      fetch_col <= fetch_col_next;
+      ahead <= 1'b1;
+    end
+
+  if (risingRD)
+    begin
+      gba_addr_lo <= gba_addr_lo + 1'b1;
+
+      if (rd_col == 7'd119)
         begin
-          gba_data_out = sound; // upper 4 bits volume / mute, lower 11 bits frequency
-          buttons <= {gba_addr_lo[7:4], gba_addr_lo[1:0]}; // button states encoded into address
+          rd_col <= 7'd0;
+          if (!rd_row[6]) rd_row <= rd_row + 1'b1;
         end
+      else
+        rd_col <= rd_col + 1'b1;
     end
-  if (risingRD) gba_addr_lo <= gba_addr_lo + 1'b1;
-  else if (fallingCS) gba_addr_lo <= gba_addr_lo_in;
+  else if (fallingCS)
+    begin
+      gba_addr_lo <= gba_addr_lo_in;
+      rd_row <= ld_row;
+      rd_col <= ld_col[6:0];
+      fetch_addr <= gba_addr_lo_in;
+      fetch_row <= ld_row;
+      fetch_col <= ld_col[6:0];
+      fetch_wait <= 1'b1;
+      rd_low <= 1'b0;
+      ahead <= 1'b0;
+
+      // a read from the start of the framebuffer or tiles begins a new frame,
+      // and any read from the beam racing window a new line
+      if (gba_addr_lo_in == 16'h8000 || gba_addr_lo_in == 16'h4000 || gba_addr_lo_in[15:14] == 2'b11)
+        read_bank <= resyncBank3;
+    end
+  if (fallingRD) rd_low <= 1'b1;
 
   // detect rising and falling edge(s)
   // (https://www.doulos.com/knowhow/fpga/synchronisation/)
@@ -80,6 +728,20 @@ begin
   // update history shifter(s)
   resyncRD <= {GBACART_RD, resyncRD[1:2]};
   resyncCS <= {GBACART_CS, resyncCS[1:2]};
+  resyncWr <= {wr_toggle, resyncWr[1:2]};
+  resyncFill <= {fill_toggle, resyncFill[1:2]};
+  resyncPcm <= {pcm_toggle, resyncPcm[1:2]};
+  resyncStat <= {stat_toggle, resyncStat[1:2]};
+
+  // shown_bank and display_mode change rarely, only pass them on once they
+  // have settled. A bank being filled isn't shown until the fill is done.
+  resyncBank1 <= shown_bank;
+  resyncBank2 <= resyncBank1;
+  if (resyncBank2 == resyncBank1 && !filling) resyncBank3 <= resyncBank2;
+
+  resyncMode1 <= display_mode;
+  resyncMode2 <= resyncMode1;
+  if (resyncMode2 == resyncMode1) resyncMode3 <= resyncMode2;
 end
 
 // instantiate tristate IO
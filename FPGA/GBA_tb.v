@@ -0,0 +1,642 @@
+`timescale 1ns / 1ps
+`default_nettype none
+`include "rom_words.vh"
+
+// Simulation of GBA.v for iverilog, run by `make sim`: an nRF52840 sending
+// frames on wclk, write_en and din, and a GBA reading the cartridge bus, each
+// checked against what it should see.
+//
+// The nRF side sends every command: words after CMD_ADDR, runs after
+// CMD_DELTA, fills, the display mode, the sound word, the PSG channels and
+// PCM samples, and reads the button events and frame counters back on
+// link_error after CMD_EVENTS. Frames end with CMD_FLIP and CMD_CHECK, the
+// check worked out here as Arduboy2Core.cpp does. One frame is sent with a
+// bad check and is refused, as are the frames of changes after it, and words
+// and fills for the bank being shown are dropped.
+//
+// The GBA side puts a halfword address on AD and drops /CS, then reads with
+// /RD, the cartridge moving to the next halfword as each /RD rises. The first
+// read takes WAIT_N wait states and the rest WAIT_S, as set by WAITCNT (4 and
+// 2 at power on). It reads every window: the ROM, the sound word and keys at
+// 0x0800, the counters at 0x0C00, the PSG channels at 0x0C10, button samples
+// at 0x1000, PCM at 0x2000, tiles at 0x4000, the bitmap at 0x8000 and the
+// beam racing bitmap at 0xC000.
+//
+// GBA.v takes the address through its /CS synchroniser, 3 to 4 clks (45 to
+// 61ns) after /CS falls, so the GBA is taken to hold it for ADDR_HOLD before
+// /RD falls and the FPGA drives AD.
+//
+// At the end it reports the GBA's sustained read bandwidth (the longest
+// burst), the link's rate, and any /RD or /CS edge that GBA.v's synchronisers
+// missed, which counts as a failure. `make sweep` runs it over a range of
+// wclk periods and wait states to find where it stops passing.
+
+module GBA_tb;
+
+parameter SERIAL_LINK = 0;
+parameter WAIT_N = 4;
+parameter WAIT_S = 2;
+parameter real ADDR_HOLD = 90.0;  // ns
+parameter real WCLK_NS = 100.0;   // wclk period
+localparam real CLK_NS = 15.152;  // 66MHz
+localparam real GBA_NS = 59.6;    // 16.78MHz
+
+localparam CMD_SOUND  = 8'h00;
+localparam CMD_ADDR   = 8'h01;
+localparam CMD_FLIP   = 8'h02;
+localparam CMD_FILL   = 8'h03;
+localparam CMD_MODE   = 8'h04;
+localparam CMD_DELTA  = 8'h05;
+localparam CMD_CHECK  = 8'h06;
+localparam CMD_EVENTS = 8'h07;
+localparam CMD_PCM    = 8'h08;
+localparam CMD_VOICE  = 8'h10; // + channel
+localparam CMD_NOTE   = 8'h14;
+
+reg         clk = 1'b0;
+reg         cs = 1'b1;
+reg         rd = 1'b1;
+reg  [15:0] ad_out = 16'h0000;
+reg         ad_drive = 1'b0;
+wire [15:0] ad;
+reg         wclk = 1'b0;
+reg         write_en = 1'b0;
+reg   [1:0] din = 2'b00;
+wire  [5:0] buttons;
+wire        link_error;
+
+assign ad = ad_drive ? ad_out : 16'hzzzz;
+
+top #(.SERIAL_LINK(SERIAL_LINK)) dut (
+  .clk(clk),
+  .GBACART_CS(cs),
+  .GBACART_RD(rd),
+  .GBACART_AD(ad),
+  .din(din),
+  .wclk(wclk),
+  .write_en(write_en),
+  .buttons(buttons),
+  .link_error(link_error)
+);
+
+always #(CLK_NS / 2) clk = !clk;
+
+reg [15:0] rom [0:`ROM_WORDS-1];
+initial $readmemh("main.hex", rom);
+
+// what the banks should hold, and what is being shown, GBA.v starting with
+// everything at 0
+reg [15:0] vram [0:1535];
+reg  [1:0] shown = 2'd0;
+integer    failures = 0;
+integer    i;
+
+initial for (i = 0; i < 1536; i = i + 1) vram[i] = 16'h0000;
+
+task verify;
+  input [15:0] got;
+  input [15:0] want;
+  input [8*24-1:0] what;
+  input integer index;
+  begin
+    if (got !== want)
+      begin
+        if (failures < 20)
+          $display("FAIL %0s %0d: got %h, want %h at %0t", what, index, got, want, $time);
+        failures = failures + 1;
+      end
+  end
+endtask
+
+
+task clks;
+  input integer count;
+  begin
+    repeat (count) @(posedge clk);
+  end
+endtask
+
+// nRF side
+//
+// din is set as wclk falls and taken as it rises, and link_error is read
+// just before each rise, as the nRF does.
+reg [191:0] events_in; // link_error, the latest in bit 0
+reg   [7:0] check_a = 0;
+reg   [7:0] check_b = 0;
+
+task wclk_cycle;
+  input       we;
+  input [1:0] d;
+  begin
+    write_en = we;
+    din = d;
+    #(WCLK_NS / 2);
+    events_in = {events_in[190:0], link_error};
+    wclk = 1'b1;
+    #(WCLK_NS / 2);
+    wclk = 1'b0;
+  end
+endtask
+
+// a two bit symbol, on din[1] a bit at a time in the serial link
+task send_symbol;
+  input       we;
+  input [1:0] symbol;
+  begin
+    if (SERIAL_LINK)
+      begin
+        wclk_cycle(we, {symbol[1], 1'b0});
+        wclk_cycle(we, {symbol[0], 1'b0});
+      end
+    else
+      wclk_cycle(we, symbol);
+  end
+endtask
+
+task check_add;
+  input [7:0] value;
+  begin
+    check_a = check_a + value;
+    check_b = check_b + check_a;
+  end
+endtask
+
+task send_byte;
+  input       we;
+  input [7:0] value;
+  begin
+    send_symbol(we, value[7:6]);
+    send_symbol(we, value[5:4]);
+    send_symbol(we, value[3:2]);
+    send_symbol(we, value[1:0]);
+    check_add(value);
+  end
+endtask
+
+task command;
+  input  [7:0] opcode;
+  input [15:0] arg;
+  begin
+    send_byte(1'b0, opcode);
+    send_byte(1'b0, arg[15:8]);
+    send_byte(1'b0, arg[7:0]);
+  end
+endtask
+
+task send_word;
+  input [15:0] word;
+  begin
+    send_byte(1'b1, word[15:8]);
+    send_byte(1'b1, word[7:0]);
+  end
+endtask
+
+// a word after CMD_ADDR or in a literal run, kept unless it's for the bank
+// being shown
+task write_word;
+  input [10:0] addr;
+  input [15:0] word;
+  begin
+    send_word(word);
+    if (addr[10:9] != shown) vram[addr] = word;
+  end
+endtask
+
+task fill;
+  input [1:0] bank;
+  input       value;
+  begin
+    command(CMD_FILL, {7'd0, value, 6'd0, bank});
+    if (bank != shown)
+      for (i = 0; i < 512; i = i + 1) vram[bank * 512 + i] = {16{value}};
+  end
+endtask
+
+// end the frame, the check sent as the FPGA should have it or spoilt
+task flip;
+  input [7:0] number;
+  input       whole;
+  input [1:0] bank;
+  input       good;
+  reg  [15:0] taken;
+  begin
+    command(CMD_FLIP, {number, 5'd0, whole, bank});
+    taken = {check_b, check_a};
+    command(CMD_CHECK, good ? taken : ~taken);
+    check_a = 0;
+    check_b = 0;
+  end
+endtask
+
+// the 192 clocks after CMD_EVENTS, the data clocked being zeros
+task read_events;
+  begin
+    for (i = 0; i < 192; i = i + 1) wclk_cycle(1'b1, 2'b00);
+    for (i = 0; i < (SERIAL_LINK ? 24 : 48); i = i + 1) check_add(8'h00);
+  end
+endtask
+
+// GBA side
+reg [15:0] got [0:16383];
+
+// the longest burst read, for the bandwidth
+integer  burst_words = 0;
+realtime burst_ns = 0;
+realtime burst_start;
+
+task gba_read;
+  input [15:0] addr;
+  input integer count;
+  integer n;
+  begin
+    ad_out = addr;
+    ad_drive = 1'b1;
+    #(GBA_NS / 2) cs = 1'b0;
+    burst_start = $realtime;
+    #(ADDR_HOLD);
+    ad_drive = 1'b0;
+    rd = 1'b0;
+    #((WAIT_N + 1) * GBA_NS - ADDR_HOLD);
+    got[0] = ad;
+    rd = 1'b1;
+    for (n = 1; n < count; n = n + 1)
+      begin
+        #(GBA_NS / 2) rd = 1'b0;
+        #((WAIT_S + 0.5) * GBA_NS);
+        got[n] = ad;
+        rd = 1'b1;
+      end
+    #(GBA_NS / 2) cs = 1'b1;
+    if (count > burst_words)
+      begin
+        burst_words = count;
+        burst_ns = $realtime - burst_start;
+      end
+    #(GBA_NS);
+  end
+endtask
+
+// a button sample, {time, buttons} in the address
+task gba_sample;
+  input [5:0] stamp;
+  input [5:0] keys;
+  begin
+    gba_read({4'h1, stamp, keys}, 1);
+  end
+endtask
+
+function pixel;
+  input [1:0] bank;
+  input integer x;
+  input integer y;
+  input [1:0] mode;
+  reg  [15:0] word;
+  begin
+    word = vram[bank * 512 + y * 8 + x / 16];
+    pixel = (word[15 - x % 16] ^ mode[0]) | mode[1];
+  end
+endfunction
+
+// a halfword of the 240 pixel wide mode 4 bitmap, the left pixel low
+function [15:0] bitmap_half;
+  input [1:0] bank;
+  input integer row;
+  input integer col;
+  input [1:0] mode;
+  begin
+    if (row >= 64 || col >= 64)
+      bitmap_half = 16'h0000;
+    else
+      bitmap_half = {{8{pixel(bank, col * 2 + 1, row, mode)}},
+                     {8{pixel(bank, col * 2, row, mode)}}};
+  end
+endfunction
+
+// a halfword of the 4bpp tiles, sixteen across, the left pixel lowest
+function [15:0] tile_half;
+  input [1:0] bank;
+  input [10:0] offset;
+  input [1:0] mode;
+  integer x;
+  integer y;
+  begin
+    x = offset[7:4] * 8 + offset[0] * 4;
+    y = offset[10:8] * 8 + offset[3:1];
+    tile_half = {3'b000, pixel(bank, x + 3, y, mode), 3'b000, pixel(bank, x + 2, y, mode),
+                 3'b000, pixel(bank, x + 1, y, mode), 3'b000, pixel(bank, x, y, mode)};
+  end
+endfunction
+
+// read the bitmap from the start, a new frame, and check rows 0 to rows - 1
+task check_bitmap;
+  input [1:0] bank;
+  input [1:0] mode;
+  input integer rows;
+  integer n;
+  begin
+    gba_read(16'h8000, rows * 120);
+    for (n = 0; n < rows * 120; n = n + 1)
+      verify(got[n], bitmap_half(bank, n / 120, n % 120, mode), "bitmap", n);
+  end
+endtask
+
+task check_tiles;
+  input [1:0] bank;
+  input [1:0] mode;
+  input integer count;
+  integer n;
+  begin
+    gba_read(16'h4000, count);
+    for (n = 0; n < count; n = n + 1)
+      verify(got[n], tile_half(bank, n, mode), "tiles", n);
+  end
+endtask
+
+task check_counters;
+  input [15:0] good;
+  input [15:0] bad;
+  input [15:0] lost;
+  begin
+    gba_read(16'h0C00, 3);
+    verify(got[0], good, "good frames", 0);
+    verify(got[1], bad, "bad frames", 0);
+    verify(got[2], lost, "lost frames", 0);
+  end
+endtask
+
+// the samples sent as bytes n * 3 + 1, a pair to each halfword read
+function [15:0] pcm_pair;
+  input integer k;
+  reg [7:0] first;
+  reg [7:0] second;
+  begin
+    first = k * 6 + 1;
+    second = k * 6 + 4;
+    pcm_pair = {second, first};
+  end
+endfunction
+
+// a small pattern for each word
+function [15:0] pattern;
+  input integer n;
+  begin
+    pattern = (n * 16'h3B1D) ^ 16'hA5C3;
+  end
+endfunction
+
+// /RD and /CS edges from the GBA against those GBA.v's synchronisers saw,
+// counted from once GBA.v has settled after power up
+reg     counting = 1'b0;
+integer rd_falls = 0, rd_rises = 0, cs_falls = 0;
+integer seen_rd_falls = 0, seen_rd_rises = 0, seen_cs_falls = 0;
+
+always @(negedge rd) if (counting) rd_falls = rd_falls + 1;
+always @(posedge rd) if (counting) rd_rises = rd_rises + 1;
+always @(negedge cs) if (counting) cs_falls = cs_falls + 1;
+
+always @(posedge clk)
+  if (counting)
+    begin
+      if (dut.fallingRD) seen_rd_falls = seen_rd_falls + 1;
+      if (dut.risingRD) seen_rd_rises = seen_rd_rises + 1;
+      if (dut.fallingCS) seen_cs_falls = seen_cs_falls + 1;
+    end
+
+task report;
+  begin
+    $display("GBA reads: %0d halfwords in %0.0f ns, %0.2f MB/s sustained",
+             burst_words, burst_ns, burst_words * 2 * 1000.0 / burst_ns);
+    $display("link: %0.2f Mbit/s", (SERIAL_LINK ? 1 : 2) * 1000.0 / WCLK_NS);
+    $display("missed edges: /RD falls %0d, /RD rises %0d, /CS falls %0d",
+             rd_falls - seen_rd_falls, rd_rises - seen_rd_rises, cs_falls - seen_cs_falls);
+    if (rd_falls != seen_rd_falls || rd_rises != seen_rd_rises || cs_falls != seen_cs_falls)
+      failures = failures + 1;
+  end
+endtask
+
+integer n;
+integer base;
+realtime flipped_at;
+realtime read_at;
+integer expected_us;
+
+initial
+begin
+  $display("SERIAL_LINK %0d, WAIT_N %0d, WAIT_S %0d, ADDR_HOLD %0.1f ns, WCLK_NS %0.2f",
+           SERIAL_LINK, WAIT_N, WAIT_S, ADDR_HOLD, WCLK_NS);
+  #(CLK_NS * 8);
+  counting = 1'b1;
+
+  // the nRF's boot: a single data clock aligns the command framing
+  wclk_cycle(1'b1, 2'b00);
+
+  $display("rom");
+  gba_read(16'h0000, 16);
+  for (n = 0; n < 16; n = n + 1) verify(got[n], rom[n], "rom", n);
+  gba_read(`ROM_WORDS - 4, 4);
+  for (n = 0; n < 4; n = n + 1) verify(got[n], rom[`ROM_WORDS - 4 + n], "rom", `ROM_WORDS - 4 + n);
+
+  $display("keys at 0x0800");
+  gba_read(16'h0800 | 16'h00B2, 1);
+  verify(got[0], 16'h0000, "sound", 0);
+  verify(buttons, 6'b1011_10, "keys", 0);
+  gba_read(16'h0800, 1); // every key down, where the sound word is read
+  verify(buttons, 6'b1011_10, "keys", 1);
+
+  $display("first frame");
+  fill(1, 1'b1);
+  command(CMD_ADDR, 512);
+  for (n = 0; n < 8; n = n + 1) write_word(512 + n, pattern(n));
+  // a literal run of 2, a skip of 5, a literal run of 1
+  command(CMD_DELTA, 512 + 100);
+  send_byte(1'b1, 8'h81);
+  write_word(612, pattern(100));
+  write_word(613, pattern(101));
+  send_byte(1'b1, 8'h04);
+  send_byte(1'b1, 8'h80);
+  write_word(619, pattern(102));
+  command(CMD_SOUND, 16'hF123);
+  for (n = 0; n < 4; n = n + 1)
+    begin
+      command(CMD_VOICE + n, 16'h1080 + n * 16'h2000);
+      command(CMD_NOTE + n, 16'h8000 | (n * 16'h111));
+    end
+  command(CMD_NOTE + 2, 16'h8765); // a second note on the wave channel
+  command(CMD_MODE, 16'h0000);
+  // 64 halfwords of PCM, two samples each, the first sent first
+  command(CMD_PCM, 16'h0000);
+  for (n = 0; n < 128; n = n + 1) send_byte(1'b1, n * 3 + 1);
+  flip(8'd0, 1'b1, 2'd1, 1'b1);
+  shown = 1;
+  clks(600); // the fill, then the bank
+  verify(link_error, 1'b0, "link error", 0);
+
+  check_counters(1, 0, 0);
+  gba_read(16'h0BFF, 1);
+  verify(got[0], 16'hF123, "sound", 0);
+  gba_read(16'h0C10, 16);
+  for (n = 0; n < 4; n = n + 1)
+    begin
+      verify(got[n * 4], 16'h1080 + n * 16'h2000, "psg voice", n);
+      verify(got[n * 4 + 1], (n == 2) ? 16'h8765 : (16'h8000 | (n * 16'h111)), "psg note", n);
+      verify(got[n * 4 + 2], (n == 2) ? 2 : 1, "psg count", n);
+      verify(got[n * 4 + 3], 16'h0000, "psg pad", n);
+    end
+
+  check_bitmap(1, 2'd0, 66); // and two rows of border
+  // loaded part way, the address split in to a row and column
+  base = 37 * 120 + 50;
+  gba_read(16'h8000 + base, 20);
+  for (n = 0; n < 20; n = n + 1)
+    verify(got[n], bitmap_half(1, (base + n) / 120, (base + n) % 120, 2'd0), "bitmap at", base + n);
+  base = 63 * 120 + 110;
+  gba_read(16'h8000 + base, 20);
+  for (n = 0; n < 20; n = n + 1)
+    verify(got[n], bitmap_half(1, (base + n) / 120, (base + n) % 120, 2'd0), "bitmap at", base + n);
+  check_tiles(1, 2'd0, 2048);
+
+  $display("button events");
+  gba_sample(6'd1, 6'h3F);
+  verify(buttons, 6'h3F, "buttons", 1);
+  gba_sample(6'd2, 6'h3E);
+  gba_sample(6'd3, 6'h3E); // no change, no event
+  gba_sample(6'd4, 6'h3C);
+  verify(buttons, 6'h3C, "buttons", 4);
+  gba_read(16'h0800 | 16'h0011, 1); // keys are ignored once samples arrive
+  verify(buttons, 6'h3C, "buttons", 5);
+  command(CMD_EVENTS, 16'h0000);
+  read_events;
+  // {count, overflow, PCM FIFO level / 32 samples, time}, then the events
+  verify(events_in[191:176], {4'd3, 1'b0, 5'd4, 6'd4}, "events header", 0);
+  verify(events_in[175:160], {4'd0, 6'd1, 6'h3F}, "event", 1);
+  verify(events_in[159:144], {4'd0, 6'd2, 6'h3E}, "event", 2);
+  verify(events_in[143:128], {4'd0, 6'd4, 6'h3C}, "event", 3);
+  for (n = 0; n < 5; n = n + 1) verify(events_in[127 - n * 16 -: 16], 16'h0000, "event padding", n);
+  // then the frame counters
+  verify(events_in[47:32], 16'd1, "events good frames", 0);
+  verify(events_in[31:16], 16'd0, "events bad frames", 0);
+  verify(events_in[15:0], 16'd0, "events lost frames", 0);
+  command(CMD_MODE, 16'h0000);
+  verify(link_error, 1'b0, "link error after events", 0);
+
+  $display("pcm");
+  gba_read(16'h2000, 65);
+  for (n = 0; n < 64; n = n + 1)
+    verify(got[n], pcm_pair(n), "pcm", n);
+  verify(got[64], 16'h0000, "pcm empty", 0);
+
+  $display("display mode");
+  command(CMD_MODE, 16'h0001);
+  clks(8);
+  check_bitmap(1, 2'd1, 8);
+  check_tiles(1, 2'd1, 256);
+  command(CMD_MODE, 16'h0002);
+  clks(8);
+  check_bitmap(1, 2'd2, 8);
+  check_tiles(1, 2'd2, 256);
+  command(CMD_MODE, 16'h0000);
+  clks(8);
+
+  $display("refused frames");
+  command(CMD_ADDR, 1024);
+  for (n = 0; n < 8; n = n + 1) write_word(1024 + n, pattern(200 + n));
+  flip(8'd1, 1'b0, 2'd2, 1'b0);
+  clks(8);
+  verify(link_error, 1'b1, "link error", 1);
+  check_counters(1, 1, 0);
+  check_bitmap(1, 2'd0, 64);
+
+  // changes alone are refused until a whole bank is written
+  command(CMD_ADDR, 1024 + 8);
+  write_word(1024 + 8, pattern(208));
+  flip(8'd2, 1'b0, 2'd2, 1'b1);
+  clks(8);
+  verify(link_error, 1'b1, "link error", 2);
+  check_counters(1, 2, 0);
+
+  // for the bank being shown, dropped
+  command(CMD_ADDR, 512 + 5);
+  write_word(512 + 5, 16'h1234);
+  fill(1, 1'b0);
+
+  // a whole bank, two frame numbers on
+  fill(2, 1'b0);
+  command(CMD_ADDR, 1024 + 40);
+  for (n = 0; n < 4; n = n + 1) write_word(1024 + 40 + n, pattern(300 + n));
+  flip(8'd5, 1'b1, 2'd2, 1'b1);
+  shown = 2;
+  clks(600);
+  verify(link_error, 1'b0, "link error", 3);
+  check_counters(2, 2, 2);
+  check_bitmap(2, 2'd0, 64);
+
+  $display("beam racing");
+  gba_read(16'h8000, 120); // a frame started on bank 2
+  command(CMD_ADDR, 512 + 10 * 8);
+  for (n = 0; n < 8; n = n + 1) write_word(512 + 10 * 8 + n, pattern(400 + n));
+  flip(8'd6, 1'b0, 2'd1, 1'b1);
+  shown = 1;
+  flipped_at = $realtime;
+  clks(8);
+  gba_read(16'h8000 + 10 * 120, 120); // the frame keeps to its bank
+  for (n = 0; n < 120; n = n + 1) verify(got[n], bitmap_half(2, 10, n, 2'd0), "frame row", n);
+  gba_read(16'hC000 + 10 * 120, 120); // the line takes the latest
+  for (n = 0; n < 120; n = n + 1) verify(got[n], bitmap_half(1, 10, n, 2'd0), "beam row", n);
+
+  $display("latency");
+  #5000;
+  read_at = $realtime;
+  gba_read(16'h8000 + 32 * 120, 4);
+  gba_read(16'h0C03, 1);
+  expected_us = (read_at - flipped_at) / 1000;
+  if (got[0] + 2 < expected_us || got[0] > expected_us + 2)
+    begin
+      $display("FAIL latency: got %0d us, want about %0d", got[0], expected_us);
+      failures = failures + 1;
+    end
+  check_counters(3, 2, 2);
+  check_bitmap(1, 2'd0, 64); // the dropped word and fill aren't there
+
+  $display("events overflow");
+  for (n = 0; n < 10; n = n + 1) gba_sample(10 + n, n[0] ? 6'h3F : 6'h3E);
+  command(CMD_EVENTS, 16'h0000);
+  read_events;
+  verify(events_in[191:176], {4'd8, 1'b1, 5'd0, 6'd19}, "events header", 1);
+  for (n = 0; n < 8; n = n + 1)
+    verify(events_in[175 - n * 16 -: 16], {4'd0, 6'd12 + n[5:0], n[0] ? 6'h3F : 6'h3E}, "event", n + 2);
+  verify(events_in[47:32], 16'd3, "events good frames", 1);
+  verify(events_in[31:16], 16'd2, "events bad frames", 1);
+  verify(events_in[15:0], 16'd2, "events lost frames", 1);
+  flip(8'd7, 1'b0, 2'd2, 1'b1);
+  shown = 2;
+  clks(8);
+  verify(link_error, 1'b0, "link error", 4);
+  check_counters(4, 2, 2);
+
+  clks(8); // the last edges through the synchronisers
+  report;
+  if (failures)
+    $display("%0d FAILED", failures);
+  else
+    $display("passed");
+  $finish;
+end
+
+endmodule
+
+// SB_IO as GBA.v uses it, PIN_TYPE 6'b101001: an output enabled by
+// OUTPUT_ENABLE and an input, neither registered
+module SB_IO #(
+  parameter [5:0] PIN_TYPE = 6'b000000,
+  parameter [0:0] PULLUP = 1'b0
+)(
+  inout  wire PACKAGE_PIN,
+  input  wire OUTPUT_ENABLE,
+  input  wire D_OUT_0,
+  output wire D_IN_0
+);
+
+assign PACKAGE_PIN = OUTPUT_ENABLE ? D_OUT_0 : 1'bz;
+assign D_IN_0 = PACKAGE_PIN;
+
+endmodule
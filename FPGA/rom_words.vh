@@ -0,0 +1 @@
+`define ROM_WORDS 610
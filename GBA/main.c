@@ -1,25 +1,280 @@
-#define REG_DISPLAY_VCOUNT (*((volatile unsigned short *)0x04000006))
-#define REG_DMA3CNT_H      (*((volatile unsigned short *)0x040000DE))
+#define REG_DISPSTAT       (*((volatile unsigned short *)0x04000004))
 #define REG_KEY_INPUT      (*((volatile unsigned short *)0x04000130))
 #define REG_SOUNDCNT_X     (*((volatile unsigned short *)0x04000084))
+#define REG_SOUND1CNT_L    (*((volatile unsigned short *)0x04000060))
+#define REG_SOUND1CNT_H    (*((volatile unsigned short *)0x04000062))
+#define REG_SOUND1CNT_X    (*((volatile unsigned short *)0x04000064))
+#define REG_SOUND2CNT_LH   (*((volatile unsigned short *)0x04000068))
+#define REG_SOUND2CNT_HX   (*((volatile unsigned short *)0x0400006C))
+#define REG_SOUND3CNT_L    (*((volatile unsigned short *)0x04000070))
+#define REG_SOUND3CNT_H    (*((volatile unsigned short *)0x04000072))
+#define REG_SOUND3CNT_X    (*((volatile unsigned short *)0x04000074))
+#define REG_SOUND4CNT_L    (*((volatile unsigned short *)0x04000078))
+#define REG_SOUND4CNT_H    (*((volatile unsigned short *)0x0400007C))
+#define WAVE_RAM           ((volatile unsigned short *)0x04000090)
+#define REG_DMA1SAD        (*((volatile unsigned long  *)0x040000BC))
+#define REG_DMA1DAD        (*((volatile unsigned long  *)0x040000C0))
+#define REG_DMA1CNT_H      (*((volatile unsigned short *)0x040000C6))
+#define REG_FIFO_A         0x040000A0
+#define REG_DMA3CNT_H      (*((volatile unsigned short *)0x040000DE))
+#define REG_TM0CNT_L       (*((volatile unsigned short *)0x04000100))
+#define REG_TM0CNT_H       (*((volatile unsigned short *)0x04000102))
+#define REG_TM1CNT_L       (*((volatile unsigned short *)0x04000104))
+#define REG_TM1CNT_H       (*((volatile unsigned short *)0x04000106))
+#define REG_TM2CNT_L       (*((volatile unsigned short *)0x04000108))
+#define REG_TM2CNT_H       (*((volatile unsigned short *)0x0400010A))
+#define REG_TM3CNT_L       (*((volatile unsigned short *)0x0400010C))
+#define REG_TM3CNT_H       (*((volatile unsigned short *)0x0400010E))
+#define REG_WAITCNT        (*((volatile unsigned short *)0x04000204))
+#define REG_IE             (*((volatile unsigned short *)0x04000200))
+#define REG_IF             (*((volatile unsigned short *)0x04000202))
+#define REG_IME            (*((volatile unsigned short *)0x04000208))
+#define REG_BIOS_IF        (*((volatile unsigned short *)0x03007FF8))
+#define REG_IRQ_HANDLER    (*((void (* volatile *)(void))0x03007FFC))
+
+#define IRQ_VBLANK 0x0001
+#define IRQ_VCOUNT 0x0004
+#define IRQ_TIMER0 0x0008
+
+// The buttons are sampled by timer 0, every 262 ticks of 64 cycles (999us),
+// and each sample read from the FPGA at 0x1000 | {time, buttons} where time
+// counts the samples. The FPGA keeps the changes, with their times, for the
+// nRF.
+#define SAMPLE_TICKS 262
+#define SAMPLE_ADDRESS 0x0A002000
+static unsigned char sample_time;
+
+// PCM samples from the nRF are played by Direct Sound A at 10512Hz, timer 1
+// overflowing every 1596 cycles (176 samples a frame). DMA 1 refills the
+// sound FIFO from the FPGA's at 0x2000 as it empties, reading further in to
+// the window each time, so it starts again from the beginning every frame.
+#define PCM_TICKS 1596
+#define PCM_ADDRESS 0x0A004000
+
+// The nRF's score plays on the four PSG channels (square 1, square 2, wave,
+// noise), each read from the FPGA at 0x0C10 + channel * 4 as {voice, note,
+// count}, the voice and note being the channel's SOUNDxCNT_H and _X values.
+// A channel is set up again when its count changes. Square 2 is left to the
+// tone from the frame's sound word while that is playing.
+#define PSG_ADDRESS 0x0A001820
+#define PSG_CHANNELS 4
+
+// Cartridge timing, as first / sequential access waitstates for the ROM at
+// 0x08000000 (WS0) and the FPGA's windows at 0x0A000000 (WS1), with the
+// prefetch buffer. At power on the FPGA's windows take 4 waits for every
+// halfword. GBA.v fetches the next halfword of a burst ahead and has it out
+// about four of its clocks (61ns) after RD rises, which fits 1 wait
+// sequential reads (120ns); `make sim` in FPGA/ reads at WAITCNT_FAST's and
+// WAITCNT_MEDIUM's timing too. The power on timing is kept until that passes
+// and the faster profiles are checked on a cartridge; pick one with
+// -DWAITCNT_PROFILE=WAITCNT_...
+#define WAITCNT_DEFAULT 0x0000 // 4/2 and 4/4, no prefetch (power on)
+#define WAITCNT_MEDIUM  0x40B4 // 3/1 and 3/1, prefetch
+#define WAITCNT_FAST    0x40D8 // 2/1 and 2/1, prefetch
+#ifndef WAITCNT_PROFILE
+#define WAITCNT_PROFILE WAITCNT_DEFAULT
+#endif
+
+// Define TILE_MODE to show the screen as 4bpp tiles on BG0 instead of as a
+// mode 4 bitmap on BG2. Each frame is then 4096 bytes from the cartridge
+// instead of 15360, but BG0 can't be scaled so the screen is 128x64 in the
+// middle of the display.
+// #define TILE_MODE
+
+// The main loop and the interrupt handler run from IWRAM as ARM code, so the
+// CPU doesn't fetch instructions over the cartridge bus while DMA is using
+// it, and without its waitstates. crt0 copies the .iwram section there at
+// boot. Define ROM_CODE to run the main loop from the cartridge as Thumb
+// code instead, to compare.
+#define IWRAM_ARM __attribute__((section(".iwram"), long_call, target("arm")))
+#ifdef ROM_CODE
+#define MAIN_CODE
+#define SWI_VBLANKINTRWAIT "swi 0x05"
+#else
+#define MAIN_CODE IWRAM_ARM
+#define SWI_VBLANKINTRWAIT "swi 0x050000" // ARM state, the number is in bits 23:16
+#endif
+
+// Define FRAME_TIME to draw the CPU time taken by each frame, from V-Blank to
+// waiting for the next, as a bar below the image, one pixel to each 256
+// cycles (a frame is 280896). Timers 2 and 3 count cycles. Building with
+// ./main.sh -DFRAME_TIME, and again adding -DROM_CODE, shows what running
+// from IWRAM saves.
+// #define FRAME_TIME
+
+// Define BEAM_RACE to race the beam in mode 4 instead: each line of the image
+// is copied from 0xC000, where the FPGA has the latest frame for every line,
+// by H-Blank DMA just before it is drawn, rather than the whole frame at
+// V-Blank. A flip on the nRF then shows from the next line drawn, but there
+// can be a tear between lines.
+// #define BEAM_RACE
+
+// Define LATENCY_BAR to draw the median latency from a flip on the nRF to the
+// middle of that frame being on screen as a bar below the image, one pixel to
+// each 128us. It is the FPGA's measurement (at 0x0C03) of the time to the
+// middle row being read, plus the lines from then until it is drawn. The
+// frame's time on the link before its flip comes on top, which replay in
+// nRF52840/Arduboy2/extras/host reports (about 60us on average with SPIM at
+// 8MHz, 1.1ms for a whole frame). Building with ./main.sh -DLATENCY_BAR, and
+// again adding -DBEAM_RACE, shows what racing the beam saves.
+// #define LATENCY_BAR
+
+#if defined(TILE_MODE) && (defined(BEAM_RACE) || defined(LATENCY_BAR) || defined(FRAME_TIME))
+#error "BEAM_RACE, LATENCY_BAR and FRAME_TIME need the mode 4 bitmap"
+#endif
+
+#ifdef BEAM_RACE
+#define LINE_BYTES 240
+#define LATENCY_LINES 33  // row 32 is read in the H-Blank after line 31,
+                          // and drawn from line 64 (scaled)
+#else
+#define LATENCY_LINES 360 // read at V-Blank (line 160), shown the V-Blank
+                          // after and drawn from line 64 of the frame after
+#endif
+
+// The frame is copied into whichever page isn't on screen, so DMA 3 can run
+// past the end of V-Blank without tearing, and the pages swap at the next
+// V-Blank. In mode 4 these are the two bitmap frames (DISPCNT bit 4), in
+// TILE_MODE the tiles at character base block 0 or 1 (BG0CNT bit 2).
+#ifdef TILE_MODE
+#define PAGE_OFFSET 0x4000
+#define PAGE_SELECT 0x0004
+#else
+#define PAGE_OFFSET 0xA000
+#define PAGE_SELECT 0x0010
+#endif
+
+// Called by the BIOS, in ARM state, for each interrupt. It is acknowledged
+// and flagged for the BIOS so that VBlankIntrWait() returns.
+IWRAM_ARM static void irqHandler(void)
+{
+    unsigned short flags = REG_IF & REG_IE;
+
+    if (flags & IRQ_TIMER0)
+    {
+        // {down, up, left, right, B, A}, active LOW
+        unsigned short keys = REG_KEY_INPUT;
+        unsigned short sample = ((sample_time++ & 0x3F) << 6) | ((keys >> 2) & 0x3C) | (keys & 0x03);
+
+        (void)*((volatile unsigned short *)(SAMPLE_ADDRESS + (sample << 1)));
+    }
+
+#ifdef BEAM_RACE
+    // the image is only 64 lines, stop before reading past it
+    if (flags & IRQ_VCOUNT) REG_DMA3CNT_H = 0x0000;
+#endif
+
+    REG_BIOS_IF |= flags;
+    REG_IF = flags;
+}
+
+// Halt the CPU until the next VBlank starts
+MAIN_CODE static inline void VBlankIntrWait(void)
+{
+    __asm__ volatile (SWI_VBLANKINTRWAIT ::: "r0", "r1", "r2", "r3", "memory");
+}
+
+#if defined(LATENCY_BAR) || defined(FRAME_TIME)
+// Draw a bar of length pixels, 3 lines high from row, in both mode 4 pages
+MAIN_CODE static void drawBar(unsigned short row, unsigned short length)
+{
+    volatile unsigned short *bar = (unsigned short *)0x06000000 + row * 120;
+    unsigned short x, y, pixels;
+
+    for (y = 0; y < 3; y++, bar += 120)
+    {
+        for (x = 0; x < 240; x += 2)
+        {
+            pixels = (x < length ? 0x00FF : 0) | (x + 1 < length ? 0xFF00 : 0);
+            bar[x >> 1] = pixels;
+            bar[(x + PAGE_OFFSET) >> 1] = pixels;
+        }
+    }
+}
+#endif
 
-int main(void)
+#ifdef FRAME_TIME
+// Cycles counted by timer 2, cascading in to timer 3
+MAIN_CODE static inline unsigned long cycles(void)
+{
+    unsigned short hi, lo;
+
+    do
+    {
+        hi = REG_TM3CNT_L;
+        lo = REG_TM2CNT_L;
+    } while (hi != REG_TM3CNT_L);
+    return ((unsigned long)hi << 16) | lo;
+}
+#endif
+
+MAIN_CODE int main(void)
 {
     volatile unsigned char *DISPCNT = (unsigned char *)0x04000000;
 
-    DISPCNT[0] = 0x04; // Use video mode 4
-    DISPCNT[1] = 0x04; // Enable BG2 (BG0 = 1, BG1 = 2, BG2 = 4, ...)
+    REG_WAITCNT = WAITCNT_PROFILE;
 
     volatile unsigned short *DMA3SAD = (unsigned short *)0x040000D4;
     volatile unsigned short *DMA3DAD = (unsigned short *)0x040000D8;
     volatile unsigned short *DMA3CNT = (unsigned short *)0x040000DC;
+
+#ifdef TILE_MODE
+    volatile unsigned short *BG0CNT = (unsigned short *)0x04000008;
+    volatile unsigned short *BG0OFS = (unsigned short *)0x04000010;
+    volatile unsigned short *BG_Palette = (unsigned short *)0x05000000;
+    volatile unsigned short *BG_Map = (unsigned short *)0x0600F800;
+    volatile unsigned short *BlankTile = (unsigned short *)0x06001000;
+    volatile unsigned short *PageSelect = BG0CNT;
+    unsigned short i;
+
+    DISPCNT[0] = 0x00; // Use video mode 0
+    DISPCNT[1] = 0x01; // Enable BG0
+    BG0CNT[0] = 0x1F00; // 4bpp, tiles at 0x06000000, map at 0x0600F800
+    BG0OFS[0] = 0x1C8;  // -56, centre the 128 pixels across
+    BG0OFS[1] = 0x1D0;  // -48, and the 64 down
+
+    // the FPGA's 128 tiles fill the top left 16x8 of the map, the rest is
+    // tile 128, left blank in both pages
+    for (i = 0; i < 16; i++)
+    {
+        BlankTile[i] = 0x0000;
+        BlankTile[i + (PAGE_OFFSET >> 1)] = 0x0000;
+    }
+    for (i = 0; i < 1024; i++)
+    {
+        BG_Map[i] = ((i & 31) < 16 && (i >> 5) < 8) ? (((i >> 5) << 4) | (i & 31)) : 128;
+    }
+
+    DMA3SAD[0] = 0x8000; // DMA 3 Source Address (tiles)
+    DMA3SAD[1] = 0x0A00;
+    DMA3DAD[0] = 0x0000; // DMA 3 Destination Address
+    DMA3DAD[1] = 0x0600;
+    DMA3CNT[0] = 0x0400; // DMA 3 Word Count (128 tiles of 32 bytes)
+    DMA3CNT[1] = 0x0400; // DMA 3 Control
+    BG_Palette[0] = 0x0000; // Colour 0 (Black)
+    BG_Palette[1] = 0x7FFF; // Colour 1 (White)
+#else
     volatile unsigned char *BG_Palette = (unsigned char *)0x050001FE;
 
+    DISPCNT[0] = 0x04; // Use video mode 4
+    DISPCNT[1] = 0x04; // Enable BG2 (BG0 = 1, BG1 = 2, BG2 = 4, ...)
+#ifndef BEAM_RACE
+    volatile unsigned short *PageSelect = (unsigned short *)DISPCNT;
+#endif
+
+#ifdef BEAM_RACE
+    DMA3SAD[0] = 0x8000; // DMA 3 Source Address (beam racing window)
+    DMA3SAD[1] = 0x0A01;
+    DMA3DAD[0] = 0x0000; // DMA 3 Destination Address
+    DMA3DAD[1] = 0x0600;
+    DMA3CNT[0] = LINE_BYTES / 4; // DMA 3 Word Count (one line)
+#else
     DMA3SAD[0] = 0x0000; // DMA 3 Source Address
     DMA3SAD[1] = 0x0A01;
     DMA3DAD[0] = 0x0000; // DMA 3 Destination Address
     DMA3DAD[1] = 0x0600;
     DMA3CNT[0] = 0x0F01; // DMA 3 Word Count (0x2581 = 240x160)
+#endif
     DMA3CNT[1] = 0x0400; // DMA 3 Control
     BG_Palette[0] = 0xFF;
     BG_Palette[1] = 0xFF; // 256th Colour (White)
@@ -31,62 +286,196 @@ int main(void)
     BG2PA[1] = 0x00;
     BG2PD[0] = 0x80; // BG2 Scaling Y-Axis
     BG2PD[1] = 0x00;
+#endif
 
     volatile unsigned short *SOUNDCNT = (unsigned short *)0x4000080;
     volatile unsigned char  *SOUND2CNT_L = (unsigned char *)0x04000068;
     volatile unsigned short *SOUND2CNT_H = (unsigned short *)0x0400006C;
 
     SOUNDCNT[2] = 0x0080;  // turn on sound circuit
-    SOUNDCNT[0] = 0x2277;  // full volume, enable Sound 2 to left and right
-    SOUNDCNT[1] = 0x0002;  // overall output ratio = full
+    SOUNDCNT[0] = 0xFF77;  // full volume, enable Sounds 1 - 4 to left and right
+    SOUNDCNT[1] = 0x0F06;  // overall output ratio = full, Direct Sound A full
+                           // volume to left and right from timer 1, reset
     SOUND2CNT_L[0] = 0x80; // duty = 50%
     SOUND2CNT_L[1] = 0x00; // mute (maximum volume = 0xF0)
+    REG_SOUND1CNT_L = 0x0008; // no sweep
+
+    // a triangle for the wave channel, written to bank 0 while 1 is selected
+    REG_SOUND3CNT_L = 0x0040;
+    for (unsigned short w = 0; w < 8; w++)
+    {
+        unsigned short i = w * 4; // four samples, high nibble first
+        unsigned short a = i < 16 ? i : 31 - i, b = i + 1 < 16 ? i + 1 : 30 - i;
+        unsigned short c = i + 2 < 16 ? i + 2 : 29 - i, d = i + 3 < 16 ? i + 3 : 28 - i;
 
+        WAVE_RAM[w] = (a << 4) | b | (c << 12) | (d << 8);
+    }
+    REG_SOUND3CNT_L = 0x0080; // 32 samples from bank 0, on
+
+#ifndef TILE_MODE
     unsigned short key_states = 0;
+#endif
     unsigned short tempShort = 0;
     unsigned char  tempChar = 0;
+    unsigned char  tone_playing = 0;
+    volatile unsigned short *PSG = (unsigned short *)PSG_ADDRESS;
+    unsigned short psg_count[PSG_CHANNELS] = { 0, 0, 0, 0 };
+    unsigned short voice, note, channel;
+#ifndef BEAM_RACE
+    unsigned char  latched = 0; // a frame is waiting in the hidden page
+#endif
+#ifdef LATENCY_BAR
+    volatile unsigned short *Latency = (unsigned short *)0x0A001806;
+    unsigned short latency_median = 0;
+    unsigned long  latency;
+#endif
+#ifdef FRAME_TIME
+    unsigned long  frame_start;
+
+    REG_TM3CNT_H = 0x0084; // timer 3 on, counting timer 2 overflows
+    REG_TM2CNT_H = 0x0080; // timer 2 on, counting cycles
+#endif
+
+    REG_DMA1SAD = PCM_ADDRESS; // DMA 1 Source Address
+    REG_DMA1DAD = REG_FIFO_A;  // DMA 1 Destination Address
+    REG_DMA1CNT_H = 0xB640;    // DMA 1 Control (sound FIFO, repeat)
+    REG_TM1CNT_L = 0x10000 - PCM_TICKS;
+    REG_TM1CNT_H = 0x0080; // timer 1 on, counting cycles
+
+    REG_TM0CNT_L = 0x10000 - SAMPLE_TICKS;
+    REG_TM0CNT_H = 0x00C1; // timer 0 on, interrupt, 64 cycle ticks
+
+    REG_IRQ_HANDLER = irqHandler;
+#ifdef BEAM_RACE
+    REG_DISPSTAT = 0x4028; // V-Blank interrupt, V-Counter interrupt at line 64
+    REG_IE = IRQ_VBLANK | IRQ_VCOUNT | IRQ_TIMER0;
+#else
+    REG_DISPSTAT = 0x0008; // V-Blank interrupt
+    REG_IE = IRQ_VBLANK | IRQ_TIMER0;
+#endif
+    REG_IME = 1;
 
     while(1)
     {
-      // Skip past the rest of any current V-Blank, then skip past the V-Draw
-      while(REG_DISPLAY_VCOUNT >= 160);
-      while(REG_DISPLAY_VCOUNT <  160);
+      VBlankIntrWait();
+#ifdef FRAME_TIME
+      frame_start = cycles();
+#endif
 
-      if (REG_DMA3CNT_H == 0x0400)
+      // back to the start of the PCM window, a missed FIFO request is made
+      // again after the next sample
+      REG_DMA1CNT_H = 0x0000;
+      REG_DMA1SAD = PCM_ADDRESS;
+      REG_DMA1CNT_H = 0xB640;
+
+#ifdef BEAM_RACE
+      // Line 0 is copied now, the CPU waiting, then each line after it in the
+      // H-Blank before it is drawn, until the V-Counter interrupt.
+      DMA3SAD[0] = 0x8000; // DMA 3 Source Address
+      DMA3DAD[0] = 0x0000; // DMA 3 Destination Address
+      DMA3CNT[1] = 0x8400; // DMA 3 Control
+      DMA3SAD[0] = 0x8000 + LINE_BYTES;
+      DMA3DAD[0] = LINE_BYTES;
+      DMA3CNT[1] = 0xA600; // DMA 3 Control (H-Blank, repeat)
+#else
+      // Everything happens at the start of V-Blank, in the same order each
+      // frame. The page filled last frame is shown, then the next frame is
+      // latched into the other one, the CPU waiting while DMA 3 runs.
+      if (latched)
       {
-        // Get current key states (REG_KEY_INPUT stores the states inverted)
-        key_states = REG_KEY_INPUT;
-
-        // upper 4 bits store volume / mute, lower 11 bits store frequency
-        tempShort = (*((volatile unsigned short *)(0x0A001000 + (key_states << 1)))); // 0x03FF
-        tempChar  = (tempShort & 0xF000) >> 8;
-        SOUND2CNT_L[1] = tempChar; // volume / mute
-        if (tempChar == 0)
-        {
-            SOUND2CNT_H[0] = 0x4000; // frequency / reset
-        }
-        else if (REG_SOUNDCNT_X == 0x0080) // Sound 2 status off
-        {
-            SOUND2CNT_H[0] = 0x8000 | (tempShort & 0x07FF); // frequency / reset
-        }
+          *PageSelect ^= PAGE_SELECT;
+      }
+      DMA3DAD[0] = (*PageSelect & PAGE_SELECT) ? 0x0000 : PAGE_OFFSET; // DMA 3 Destination Address (hidden page)
+      DMA3CNT[1] = 0x8400; // DMA 3 Control
+      latched = 1;
+#endif
 
-        if (key_states == 0x01FF) // BUTTON_L, Scaling ON
-        {
-            BG2PA[0] = 0x89; // BG2 Scaling X-Axis
-            BG2PA[1] = 0x00;
-            BG2PD[0] = 0x80; // BG2 Scaling Y-Axis
-            BG2PD[1] = 0x00;
-        }
-        if (key_states == 0x02FF) // BUTTON_R, Scaling OFF
-        {
-            BG2PA[0] = 0x00; // BG2 Scaling X-Axis
-            BG2PA[1] = 0x01;
-            BG2PD[0] = 0x00; // BG2 Scaling Y-Axis
-            BG2PD[1] = 0x01;
-        }
+      // upper 4 bits store volume / mute, lower 11 bits store frequency
+      tempShort = *((volatile unsigned short *)0x0A001000);
+      tempChar  = (tempShort & 0xF000) >> 8;
+      if (tempChar != 0)
+      {
+          SOUND2CNT_L[0] = 0x80; // duty = 50%
+          SOUND2CNT_L[1] = tempChar; // volume
+          if (!(REG_SOUNDCNT_X & 0x0002)) // Sound 2 status off
+          {
+              SOUND2CNT_H[0] = 0x8000 | (tempShort & 0x07FF); // frequency / reset
+          }
+          tone_playing = 1;
+      }
+      else if (tone_playing)
+      {
+          SOUND2CNT_L[1] = 0x00; // mute
+          SOUND2CNT_H[0] = 0x4000; // frequency / reset
+          tone_playing = 0;
+      }
+
+      for (channel = 0; channel < PSG_CHANNELS; channel++)
+      {
+          tempShort = PSG[channel * 4 + 2];
+          if (tempShort == psg_count[channel]) continue;
 
-        DMA3CNT[1] = 0x8400; // DMA 3 Control
+          voice = PSG[channel * 4];
+          note = PSG[channel * 4 + 1];
+          if (PSG[channel * 4 + 2] != tempShort) continue; // changing, next frame
+          psg_count[channel] = tempShort;
+
+          switch (channel)
+          {
+          case 0:
+              REG_SOUND1CNT_H = voice;
+              REG_SOUND1CNT_X = note;
+              break;
+          case 1:
+              if (tone_playing) break;
+              REG_SOUND2CNT_LH = voice;
+              REG_SOUND2CNT_HX = note;
+              break;
+          case 2: // the nearest of 0, 25, 50 or 100% volume
+              tempChar = voice >> 12;
+              REG_SOUND3CNT_H = tempChar == 0 ? 0x0000 : tempChar < 5 ? 0x6000 :
+                                tempChar < 9 ? 0x4000 : 0x2000;
+              REG_SOUND3CNT_X = note;
+              break;
+          case 3:
+              REG_SOUND4CNT_L = voice & 0xFF00;
+              REG_SOUND4CNT_H = note;
+              break;
+          }
       }
+
+#ifndef TILE_MODE
+      // Get current key states (REG_KEY_INPUT stores the states inverted),
+      // only used here for L and R, the FPGA has them from timer 0
+      key_states = REG_KEY_INPUT;
+
+      if (key_states == 0x01FF) // BUTTON_L, Scaling ON
+      {
+          BG2PA[0] = 0x89; // BG2 Scaling X-Axis
+          BG2PA[1] = 0x00;
+          BG2PD[0] = 0x80; // BG2 Scaling Y-Axis
+          BG2PD[1] = 0x00;
+      }
+      if (key_states == 0x02FF) // BUTTON_R, Scaling OFF
+      {
+          BG2PA[0] = 0x00; // BG2 Scaling X-Axis
+          BG2PA[1] = 0x01;
+          BG2PD[0] = 0x00; // BG2 Scaling Y-Axis
+          BG2PD[1] = 0x01;
+      }
+#endif
+
+#ifdef LATENCY_BAR
+      // a line is 1232 cycles at 16.78MHz, 73.4us. The median moves towards
+      // each measurement by 64us.
+      latency = *Latency + (LATENCY_LINES * 734UL) / 10;
+      if (latency > latency_median + 64UL) latency_median += 64;
+      else if (latency + 64UL < latency_median) latency_median -= 64;
+      drawBar(72, latency_median >> 7);
+#endif
+#ifdef FRAME_TIME
+      drawBar(76, (cycles() - frame_start) >> 8);
+#endif
     }
     return 0;
 }
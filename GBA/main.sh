@@ -1,4 +1,22 @@
-arm-none-eabi-gcc -c main.c -mthumb-interwork -mthumb -O2 -o main.o
+set -e
+
+# any arguments go to the compiler, e.g. ./main.sh -DFRAME_TIME to build with
+# the frame time bar, or -DWAITCNT_PROFILE=WAITCNT_FAST
+arm-none-eabi-gcc -c main.c -mthumb-interwork -mthumb -mlong-calls -O2 "$@" -o main.o
 arm-none-eabi-gcc main.o -mthumb-interwork -mthumb -specs=gba.specs -o main.elf
 arm-none-eabi-objcopy -v -O binary main.elf main.gba
 gbafix main.gba
+
+# the FPGA serves main.gba as halfwords from ../FPGA/main.hex, and GBA.v
+# takes their count, ROM_WORDS, from ../FPGA/rom_words.vh
+printf '%s' "$(od -An -v -tx2 --endian=little main.gba | tr a-f A-F | xargs)" > ../FPGA/main.hex
+words=$(wc -w < ../FPGA/main.hex)
+if [ "$words" -gt 2048 ]; then
+  echo "main.gba is $words halfwords, the FPGA's ROM window holds 2048" >&2
+  exit 1
+fi
+# with the main.c and options it came from, for FPGA/Makefile to check
+{
+  echo "\`define ROM_WORDS $words"
+  echo "// main.c $(sha1sum < main.c | cut -c1-40) $*"
+} > ../FPGA/rom_words.vh
@@ -2,22 +2,26 @@
 Play a musical composition in the background while
 the main sketch code runs in the foreground.
 
-The ArduboyPlaytune library must be installed to use this sketch
-https://github.com/Arduboy/ArduboyPlayTune
+The score is played on the GBA's PSG channels by the library's
+own player, stepped by display(), so no other library is needed.
 
-The D-Pad buttons will move the text and play a tone.
+The D-Pad buttons will move the text and play a tone, with a
+click mixed in as PCM samples.
 
 The A button mutes the sound.
 The screen is inverted when sound is muted.
 
 The B button will turn sound back on if it's muted.
 
-The score that is played contains two parts.
-With the DevKit only one part is played.
+The score that is played contains two parts, on square 1 and
+square 2. A tone takes square 2 while it plays.
 ***************************************************************/
 
 #include <Arduboy2.h>
-#include <ArduboyPlaytune.h>
+
+// tone and click lengths
+#define TONE_FRAMES 8     // 300 ms at 25 frames per second
+#define CLICK_SAMPLES 420 // 40 ms at PCM_RATE
 
 // 2 Part Inventions No. 3 - J.S. Bach
 const byte score[] PROGMEM = {
@@ -127,7 +131,9 @@ const byte score[] PROGMEM = {
 };
 
 Arduboy2 arduboy;
-ArduboyPlaytune tunes(arduboy.audio.enabled);
+
+bool muted = false;
+int8_t click[CLICK_SAMPLES];
 
 void setup()
 {
@@ -136,59 +142,68 @@ void setup()
   arduboy.setFrameRate(25);
   arduboy.setTextSize(3);
 
-  // audio setup
-  tunes.initChannel(PIN_SPEAKER_1);
-#ifndef AB_DEVKIT
-  // if not a DevKit
-  tunes.initChannel(PIN_SPEAKER_2);
-#else
-  // if it's a DevKit
-  tunes.initChannel(PIN_SPEAKER_1); // use the same pin for both channels
-  tunes.toneMutesScore(true);       // mute the score when a tone is sounding
-#endif
-
-  arduboy.invert(!arduboy.audio.enabled()); // invert display if sound muted
+  // a decaying burst of noise
+  for (int i = 0; i < CLICK_SAMPLES; i++) {
+    click[i] = (int8_t) (random(-64, 64) * (CLICK_SAMPLES - i) / CLICK_SAMPLES);
+  }
+
+  arduboy.invert(muted);
 }
 
 
 int x = 20, y = 10; // initial text position
 
+// play a tone while the button is held, and a click when it's pressed
+void playTone(uint8_t button, uint16_t note)
+{
+  if (muted)
+    return;
+
+  arduboy.tone(note, TONE_FRAMES);
+  if (arduboy.justPressed(button))
+    arduboy.pcmWrite(click, CLICK_SAMPLES);
+}
+
 void loop()
 {
   // pause render until it's time for the next frame
   if (!(arduboy.nextFrame()))
     return;
 
+  arduboy.pollButtons();
+  arduboy.timer(); // handle the tone's duration
+
   if (arduboy.pressed(UP_BUTTON)) {
     y-=1;
-    tunes.tone(1175,300);
+    playTone(UP_BUTTON, NOTE_D7);
   } else if (arduboy.pressed(DOWN_BUTTON)) {
     y+=1;
-    tunes.tone(1397,300);
+    playTone(DOWN_BUTTON, NOTE_F7);
   } else if (arduboy.pressed(LEFT_BUTTON)) {
     x-=1;
-    tunes.tone(1047,300);
+    playTone(LEFT_BUTTON, NOTE_C7);
   } else if (arduboy.pressed(RIGHT_BUTTON)) {
     x+=1;
-    tunes.tone(1319,300);
+    playTone(RIGHT_BUTTON, NOTE_E7);
   }
 
   if (arduboy.pressed(A_BUTTON)) {
+    muted = true;
     arduboy.invert(true);
-    arduboy.audio.off();
+    arduboy.stopScore();
   } else if (arduboy.pressed(B_BUTTON)) {
+    muted = false;
     arduboy.invert(false);
-    arduboy.audio.on();
   }
 
+  // play the tune if we aren't already
+  if (!muted && !arduboy.scorePlaying())
+    arduboy.playScore(score);
+
   arduboy.clear();
   arduboy.setCursor(x,y);
   arduboy.print("Music");
   arduboy.setCursor(x+8,y+24);
   arduboy.print("Demo");
   arduboy.display();
-
-  // play the tune if we aren't already
-  if (!tunes.playing())
-    tunes.playScore(score);
 }
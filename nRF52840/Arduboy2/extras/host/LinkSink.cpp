@@ -0,0 +1,335 @@
+#include "LinkSink.h"
+
+#include <string.h>
+
+// opcodes, as GBA.v
+#define CMD_SOUND  0x00
+#define CMD_ADDR   0x01
+#define CMD_FLIP   0x02
+#define CMD_FILL   0x03
+#define CMD_MODE   0x04
+#define CMD_DELTA  0x05
+#define CMD_CHECK  0x06
+#define CMD_EVENTS 0x07
+#define CMD_PCM    0x08
+#define CMD_VOICE  0x04 // opcode bits 7:2, the PSG channel in 1:0
+#define CMD_NOTE   0x05
+
+LinkSink::LinkSink(bool serial) : serial(serial)
+{
+  memset(vram, 0, sizeof(vram));
+  memset(psgVoice, 0, sizeof(psgVoice));
+  memset(psgNote, 0, sizeof(psgNote));
+  memset(psgCount, 0, sizeof(psgCount));
+  memset(eventRing, 0, sizeof(eventRing));
+  memset(pcmFifo, 0, sizeof(pcmFifo));
+  memset(&last, 0, sizeof(last));
+}
+
+// words for the bank being shown are dropped
+void LinkSink::writeWord(uint16_t addr, uint16_t data)
+{
+  if (addr >= BANKS * BANK_WORDS) return; // no bank 3
+  if (addr / BANK_WORDS == shownBank)
+  {
+    shownWrites++;
+    return;
+  }
+  vram[addr] = data;
+}
+
+// the 16 bit word the events are sent from, as events_data
+uint16_t LinkSink::eventsData() const
+{
+  uint8_t word = eventsBit >> 4;
+  uint16_t level = pcmLevel();
+  uint8_t report = (level & 0x200) ? 31 : (level >> 4) & 0x1F;
+
+  if (word == 0)
+    return (eventsCount << 12) | (eventsOverflow << 11) | (report << 6) | (sampleTime & 0x3F);
+  if (word <= eventsCount)
+    return eventRing[(eventsFirst + word - 1) & 15];
+  if (word == 9) return goodFrames;
+  if (word == 10) return badFrames;
+  if (word == 11) return lostFrames;
+  return 0;
+}
+
+void LinkSink::fall()
+{
+  eventsPin = (eventsData() >> (15 - (eventsBit & 15))) & 1;
+}
+
+void LinkSink::rise(bool writeEn, uint8_t din)
+{
+  clocks++;
+
+  if (corruptAt && --corruptAt == 0)
+  {
+    din ^= 2;
+    corruptedClock = clocks;
+  }
+
+  bool restart = (writeEn != writeEnQ);
+  uint8_t symbol = serial ? ((halfBit << 1) | (din >> 1)) : din;
+  bool symbolValid = serial ? (half && !restart) : true;
+
+  writeEnQ = writeEn;
+  halfBit = din >> 1;
+  half = restart ? true : !half;
+
+  if (!symbolValid)
+  {
+    if (writeEn)
+    {
+      cmdCount = 0;
+      if (eventsOut && eventsBit != 0xFF) eventsBit++;
+    }
+    return;
+  }
+
+  uint32_t cmdWord = (cmdShift << 2) | symbol;
+
+  // the sums before this byte are taken for CMD_CHECK
+  if (!writeEn && cmdCount == 3 && (cmdWord & 0xFF) == CMD_CHECK)
+    checkTaken = (checkB << 8) | checkA;
+
+  // the check, a byte at a time
+  bool checkValid = writeEn ? ((pixelCount & 3) == 3) : ((cmdCount & 3) == 3);
+  if (checkValid)
+  {
+    uint8_t byte = writeEn ? (((pixels & 0x3F) << 2) | symbol) : (cmdWord & 0xFF);
+
+    checkA += byte;
+    checkB += checkA;
+  }
+
+  if (writeEn)
+  {
+    uint16_t word = ((pixels & 0x3FFF) << 2) | symbol;
+    uint8_t count = pixelCount;
+
+    pixels = word & 0x3FFF;
+    pixelCount = (pixelCount + 1) & 7;
+
+    if (eventsOut)
+    {
+      // clocks for the events, the data is dropped
+    }
+    else if (pcm)
+    {
+      if (count == 7)
+      {
+        // first sample in the low byte
+        uint16_t pair = (word << 8) | (word >> 8);
+
+        if (pcmLevel() != PCM_WORDS) // dropped when full
+        {
+          pcmFifo[pcmWr % PCM_WORDS] = pair;
+          pcmWr = (pcmWr + 1) & 0x3FF;
+        }
+      }
+    }
+    else if (delta && !literal)
+    {
+      if (count == 3) // run header
+      {
+        uint8_t header = word & 0xFF;
+
+        pixelCount = 0;
+        if (header & 0x80)
+        {
+          literal = true;
+          run = header & 0x7F;
+        }
+        else
+          waddr = (waddr + (header & 0x7F) + 1) & 0x7FF;
+      }
+    }
+    else if (count == 7)
+    {
+      writeWord(waddr, word);
+      waddr = (waddr + 1) & 0x7FF;
+
+      if (run == 0) literal = false;
+      else run--;
+    }
+
+    cmdCount = 0;
+    if (eventsOut && eventsBit != 0xFF) eventsBit++;
+    return;
+  }
+
+  eventsOut = false;
+  cmdShift = cmdWord & 0x3FFFFF;
+
+  if (cmdCount == 11)
+  {
+    cmdCount = 0;
+    command(cmdWord & 0xFFFFFF);
+  }
+  else
+    cmdCount++;
+}
+
+void LinkSink::command(uint32_t word)
+{
+  uint8_t opcode = word >> 16;
+  uint16_t arg = word & 0xFFFF;
+
+  if ((opcode >> 2) == CMD_VOICE)
+    psgVoice[opcode & 3] = arg;
+  if ((opcode >> 2) == CMD_NOTE)
+  {
+    psgNote[opcode & 3] = arg;
+    psgCount[opcode & 3] = (psgCount[opcode & 3] + 1) & 15;
+  }
+
+  switch (opcode)
+  {
+    case CMD_SOUND:
+      sound = arg;
+      break;
+    case CMD_ADDR:
+      waddr = arg & 0x7FF;
+      pixelCount = 0;
+      delta = false;
+      pcm = false;
+      break;
+    case CMD_DELTA:
+      waddr = arg & 0x7FF;
+      pixelCount = 0;
+      delta = true;
+      literal = false;
+      pcm = false;
+      break;
+    case CMD_PCM:
+      pixelCount = 0;
+      pcm = true;
+      break;
+    case CMD_FLIP:
+      flipArg = arg;
+      flipPending = true;
+      break;
+    case CMD_CHECK:
+    {
+      uint8_t number = flipArg >> 8;
+
+      last.clocks = clocks;
+      last.stores = stores;
+      last.bank = flipArg & 3;
+      last.whole = flipArg & 4;
+      bool good = flipPending && arg == checkTaken;
+
+      last.accepted = good && (!frameError || (flipArg & 4));
+      clocks = 0;
+      stores = 0;
+      flips++;
+
+      if (last.accepted)
+      {
+        shownBank = flipArg & 3;
+        goodFrames++;
+        frameError = false;
+      }
+      else
+      {
+        badFrames++;
+        frameError = true;
+      }
+
+      // The number of a frame that fails its check can't be trusted. A frame
+      // can also fail twice, so a number behind is taken without counting.
+      if (!good)
+        nextFrame++;
+      else
+      {
+        uint8_t skipped = number - nextFrame;
+
+        if (skipped < 128) lostFrames += skipped;
+        nextFrame = number + 1;
+      }
+
+      checkA = 0;
+      checkB = 0;
+      flipPending = false;
+
+      if (flipped) flipped();
+      break;
+    }
+    case CMD_FILL:
+      if ((arg & 3) < BANKS && (arg & 3) != shownBank)
+      {
+        for (uint16_t i = 0; i < BANK_WORDS; i++)
+          writeWord((arg & 3) * BANK_WORDS + i, (arg & 0x100) ? 0xFFFF : 0x0000);
+      }
+      break;
+    case CMD_MODE:
+      displayMode = arg & 3;
+      break;
+    case CMD_EVENTS:
+    {
+      uint8_t pending = (eventWr - eventsRd) & 0x3F;
+
+      eventsOut = true;
+      eventsBit = 0;
+      pixelCount = 0;
+      eventsOverflow = (pending > 8);
+      if (pending > 8)
+      {
+        eventsCount = 8;
+        eventsFirst = (eventWr - 8) & 0x3F;
+      }
+      else
+      {
+        eventsCount = pending;
+        eventsFirst = eventsRd;
+      }
+      eventsRd = eventWr;
+      break;
+    }
+  }
+}
+
+void LinkSink::buttonSample(uint8_t time, uint8_t buttons)
+{
+  uint16_t sample = ((time & 0x3F) << 6) | (buttons & 0x3F);
+
+  if ((buttons & 0x3F) != sampleButtons)
+  {
+    if (((eventWr - eventsRd) & 0x3F) == 63)
+      eventRing[(eventWr - 1) & 15] = sample; // full
+    else
+    {
+      eventRing[eventWr & 15] = sample;
+      eventWr = (eventWr + 1) & 0x3F;
+    }
+  }
+
+  sampleButtons = buttons & 0x3F;
+  sampleTime = time & 0x3F;
+}
+
+uint16_t LinkSink::pcmRead()
+{
+  if (pcmLevel() == 0) return 0;
+
+  uint16_t pair = pcmFifo[pcmRd % PCM_WORDS];
+  pcmRd = (pcmRd + 1) & 0x3FF;
+  return pair;
+}
+
+void LinkSink::image(uint8_t bank, uint8_t image[]) const
+{
+  memset(image, 0, 1024);
+  for (uint8_t y = 0; y < 64; y++)
+  {
+    for (uint8_t x = 0; x < 128; x++)
+    {
+      uint16_t word = vram[bank * BANK_WORDS + y * 8 + x / 16];
+
+      if (word & (0x8000 >> (x & 15)))
+        image[(y / 8) * 128 + x] |= 1 << (y & 7);
+    }
+  }
+}
@@ -0,0 +1,132 @@
+// A model of the FPGA end of the nRF52840 link, following GBA.v.
+//
+// The wclk domain is modelled clock by clock: symbols, commands, pixel words,
+// delta runs, the check, flips, the button events sent back on link error and
+// PCM samples. What GBA.v then does in its clk domain (writing VRAM, fills,
+// the counters, the PCM FIFO and the event ring) happens straight away.
+//
+// Each check ends a frame, and the wclk clocks and port stores it took are
+// kept in `last`.
+
+#ifndef LINK_SINK_H
+#define LINK_SINK_H
+
+#include <stdint.h>
+
+class LinkSink
+{
+  public:
+    static const uint16_t BANK_WORDS = 512; // 128x64 pixels, 16 to a word
+    static const uint8_t BANKS = 3;
+    static const uint8_t PSG_CHANNELS = 4;
+    static const uint16_t PCM_WORDS = 512;  // two samples to a word
+
+    // serial: one bit per clock on d0 (SERIAL_LINK = 1), otherwise a two bit
+    // symbol on {d0, d1}
+    explicit LinkSink(bool serial);
+
+    // The nRF side. din is {d0, d1}, d0 the more significant.
+    void rise(bool writeEn, uint8_t din);
+    void fall();
+    bool linkError() const { return eventsOut ? eventsPin : frameError; }
+    void store() { stores++; } // a store to the port, counted for the frame
+
+    // invert d0 at the given clock from now, to have a frame fail its check,
+    // or with 0 forget it
+    void corrupt(uint32_t clocks) { corruptAt = clocks; }
+    bool corruptPending() const { return corruptAt != 0; }
+    uint32_t corruptedAt() const { return corruptedClock; } // in its frame
+
+    // The GBA side: a button sample read at 0x1000 | {time, buttons}, and a
+    // halfword read from the PCM window
+    void buttonSample(uint8_t time, uint8_t buttons);
+    uint16_t pcmRead();
+    uint16_t pcmLevel() const { return (pcmWr - pcmRd) & 0x3FF; }
+
+    // a bank in the page layout of Arduboy2Base::sBuffer
+    void image(uint8_t bank, uint8_t image[]) const;
+
+    struct Frame
+    {
+      uint32_t clocks;  // wclk rising edges
+      uint32_t stores;  // port stores
+      uint8_t bank;
+      bool whole;       // CMD_FLIP said the whole bank was written
+      bool accepted;    // the bank is now shown: the check passed, and the
+                        // whole bank was written if a frame had been refused
+    };
+
+    Frame last;             // the frame ended by the latest check
+    void (*flipped)() = nullptr; // called after each check
+    uint32_t flips = 0;
+    uint32_t clocks = 0;    // since the latest check
+    uint32_t stores = 0;
+    uint32_t shownWrites = 0; // words for the bank being shown, dropped
+
+    uint16_t vram[BANKS * BANK_WORDS];
+    uint8_t shownBank = 0;
+    uint8_t displayMode = 0;
+    uint16_t sound = 0;
+    uint16_t psgVoice[PSG_CHANNELS];
+    uint16_t psgNote[PSG_CHANNELS];
+    uint8_t psgCount[PSG_CHANNELS];
+    uint16_t goodFrames = 0;
+    uint16_t badFrames = 0;
+    uint16_t lostFrames = 0;
+
+  private:
+    void command(uint32_t word);
+    void writeWord(uint16_t addr, uint16_t data);
+    uint16_t eventsData() const;
+
+    const bool serial;
+    uint32_t corruptAt = 0;
+    uint32_t corruptedClock = 0;
+
+    // symbols
+    bool writeEnQ = false;
+    bool half = true;
+    uint8_t halfBit = 0;
+
+    // data
+    uint16_t pixels = 0;    // 14 bits
+    uint8_t pixelCount = 0; // 3 bits
+    bool delta = false;
+    bool literal = false;
+    bool pcm = false;
+    uint8_t run = 0;
+    uint16_t waddr = 0;     // 11 bits
+
+    // commands
+    uint32_t cmdShift = 0;  // 22 bits
+    uint8_t cmdCount = 0;
+
+    // check
+    uint8_t checkA = 0;
+    uint8_t checkB = 0;
+    uint16_t checkTaken = 0;
+    uint16_t flipArg = 0;   // CMD_FLIP, acted on by CMD_CHECK
+    bool flipPending = false;
+    bool frameError = false;
+    uint8_t nextFrame = 0;
+
+    // button events
+    uint16_t eventRing[16];
+    uint8_t sampleButtons = 0;
+    uint8_t sampleTime = 0;
+    uint8_t eventWr = 0;      // 6 bits
+    uint8_t eventsRd = 0;     // 6 bits
+    uint8_t eventsFirst = 0;
+    uint8_t eventsCount = 0;
+    bool eventsOverflow = false;
+    bool eventsOut = false;
+    uint8_t eventsBit = 0;
+    bool eventsPin = false;
+
+    // PCM FIFO
+    uint16_t pcmFifo[PCM_WORDS];
+    uint16_t pcmWr = 0;       // 10 bits
+    uint16_t pcmRd = 0;
+};
+
+#endif
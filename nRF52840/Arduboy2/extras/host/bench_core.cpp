@@ -0,0 +1,160 @@
+// Compares paintScreen() with the baseline's: the time to turn the image's
+// pages in to scanlines, and the port stores and wclk clocks of a whole
+// frame. Times are for the host, not the nRF52840.
+//
+// Arduboy2Core.cpp is built in to this file to reach transposePage().
+
+#include <time.h>
+
+#include "host.h"
+
+#include "../../src/Arduboy2Core.cpp"
+
+#define BUFFER_BYTES ((WIDTH * HEIGHT) / 8)
+#define ROUNDS 20000
+
+static uint8_t image[BUFFER_BYTES];
+
+// the baseline's loop, a bit of each of the page's bytes for each row
+static void baselinePage(const uint8_t *page, uint8_t *scanlines)
+{
+  for (uint8_t r = 0; r < 8; r++)
+  {
+    uint8_t bitMask = B00000001 << r;
+
+    for (uint8_t x = 0; x < WIDTH; x++)
+    {
+      uint8_t *out = &scanlines[r * (WIDTH / 8) + x / 8];
+
+      if (page[x] & bitMask) *out |= 0x80 >> (x & 7);
+      else                   *out &= ~(0x80 >> (x & 7));
+    }
+  }
+}
+
+// the baseline's paintScreen(), each symbol set with OUTSET and OUTCLR and
+// each line padded to the GBA's 240 pixels
+static void baselinePaintScreen(const uint8_t image[])
+{
+  NRF_P0->OUTSET = DC_BIT; // dc HIGH
+
+  for (uint8_t t = 0; t < 8; t++) // eight 'pages'
+  {
+    for (uint8_t r = 0; r < 8; r++) // eight bits
+    {
+      uint16_t a = t * 128; // starting address
+      uint8_t bitMask = B00000001 << r;
+
+      for (uint8_t i = 0; i < 64; i++) // two pixels each clock
+      {
+        if (image[a++] & bitMask) NRF_P0->OUTSET = D0_BIT;
+        else                      NRF_P0->OUTCLR = D0_BIT;
+        if (image[a++] & bitMask) NRF_P0->OUTSET = D1_BIT;
+        else                      NRF_P0->OUTCLR = D1_BIT;
+
+        NRF_P0->OUTCLR = WCLK_BIT; // wclk LOW
+        NRF_P0->OUTSET = WCLK_BIT; // wclk HIGH
+      }
+
+      NRF_P0->OUTCLR = D0_BIT;
+      NRF_P0->OUTCLR = D1_BIT;
+
+      for (uint8_t i = 0; i < 56; i++) // 128 + 112 = 240 horizontal pixels
+      {
+        NRF_P0->OUTCLR = WCLK_BIT; // wclk LOW
+        NRF_P0->OUTSET = WCLK_BIT; // wclk HIGH
+      }
+    }
+  }
+
+  NRF_P0->OUTCLR = DC_BIT; // dc LOW
+
+  for (uint8_t i = 0; i < 8; i++) // the sound, two bytes
+  {
+    NRF_P0->OUTCLR = D0_BIT;
+    NRF_P0->OUTCLR = D1_BIT;
+    NRF_P0->OUTCLR = WCLK_BIT; // wclk LOW
+    NRF_P0->OUTSET = WCLK_BIT; // wclk HIGH
+  }
+}
+
+static double seconds()
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main()
+{
+  uint8_t baseline[8 * (WIDTH / 8)];
+  uint8_t transposed[8 * (WIDTH / 8)];
+  uint32_t sum = 0;
+  unsigned failures = 0;
+
+  for (uint16_t i = 0; i < BUFFER_BYTES; i++) image[i] = random(256);
+
+  // the two give the same scanlines
+  for (uint8_t t = 0; t < 8; t++)
+  {
+    baselinePage(&image[t * WIDTH], baseline);
+    transposePage(&image[t * WIDTH], 0, WIDTH, transposed);
+    if (memcmp(baseline, transposed, sizeof(baseline)) != 0) failures++;
+  }
+
+  double start = seconds();
+  for (uint32_t round = 0; round < ROUNDS; round++)
+  {
+    for (uint8_t t = 0; t < 8; t++)
+    {
+      baselinePage(&image[t * WIDTH], baseline);
+      sum += baseline[round & 127];
+    }
+    image[round % BUFFER_BYTES]++;
+  }
+  double baselineNs = (seconds() - start) * 1e9 / ROUNDS;
+
+  start = seconds();
+  for (uint32_t round = 0; round < ROUNDS; round++)
+  {
+    for (uint8_t t = 0; t < 8; t++)
+    {
+      transposePage(&image[t * WIDTH], 0, WIDTH, transposed);
+      sum += transposed[round & 127];
+    }
+    image[round % BUFFER_BYTES]++;
+  }
+  double transposeNs = (seconds() - start) * 1e9 / ROUNDS;
+
+  printf("pages to scanlines, a whole frame (host)\n");
+  printf("  baseline bit loop  %8.0f ns\n", baselineNs);
+  printf("  transposePage()    %8.0f ns  (%.1fx)\n", transposeNs, baselineNs / transposeNs);
+
+  // a whole frame on the port, then the baseline's
+  Arduboy2Core::boot();
+  hostSink.clocks = 0;
+  hostSink.stores = 0;
+  Arduboy2Core::paintScreen(image);
+  uint32_t clocks = hostSink.last.clocks;
+  uint32_t stores = hostSink.last.stores;
+
+  hostSink.clocks = 0;
+  hostSink.stores = 0;
+  baselinePaintScreen(image);
+  uint32_t baselineClocks = hostSink.clocks;
+  uint32_t baselineStores = hostSink.stores;
+
+  printf("a whole frame on the port\n");
+  printf("  baseline           %8u clocks %8u stores\n",
+         (unsigned) baselineClocks, (unsigned) baselineStores);
+  printf("  paintScreen()      %8u clocks %8u stores  (%.1fx fewer stores)\n",
+         (unsigned) clocks, (unsigned) stores, (double) baselineStores / stores);
+
+  if (failures || sum == 0xFFFFFFFF)
+  {
+    printf("transposePage() differs from the baseline loop\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,896 @@
+// Compares the library's drawing with the baseline's: each baseline routine
+// is drawn in to one buffer and the library's in to another, the two are
+// checked to match, and then each is timed over the same calls. Times are for
+// the host, not the nRF52840.
+
+#include <time.h>
+
+#include <Arduboy2.h>
+#include <Sprites.h>
+#include <SpritesB.h>
+
+#include "host.h"
+
+#define BUFFER_BYTES ((WIDTH * HEIGHT) / 8)
+#define CALLS 4096
+
+static Arduboy2Base arduboy;
+static uint8_t *const buffer = Arduboy2Base::sBuffer;
+static uint8_t baseline[BUFFER_BYTES];
+static unsigned failures = 0;
+
+static uint32_t randomState = 1;
+
+static uint16_t randomWord()
+{
+  randomState = randomState * 1103515245 + 12345;
+  return randomState >> 16;
+}
+
+static int16_t randomBetween(int16_t low, int16_t high)
+{
+  return low + randomWord() % (high - low + 1);
+}
+
+static double seconds()
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Both buffers start from the same noise, the calls are made to each and the
+// results compared, then each is timed over the calls. Returns the baseline's
+// time over the library's.
+template <typename Baseline, typename Library>
+static double compare(const char *name, Baseline baselineCall, Library libraryCall)
+{
+  for (uint16_t i = 0; i < BUFFER_BYTES; i++)
+    baseline[i] = buffer[i] = randomWord();
+
+  for (uint16_t c = 0; c < CALLS; c++)
+  {
+    baselineCall(c);
+    libraryCall(c);
+  }
+  if (memcmp(baseline, buffer, BUFFER_BYTES) != 0)
+  {
+    printf("  %s differs from the baseline\n", name);
+    failures++;
+  }
+
+  double best[2] = { 1e9, 1e9 };
+
+  for (uint8_t round = 0; round < 20; round++)
+  {
+    double start = seconds();
+    for (uint16_t c = 0; c < CALLS; c++) baselineCall(c);
+    double middle = seconds();
+    for (uint16_t c = 0; c < CALLS; c++) libraryCall(c);
+    double end = seconds();
+
+    if (middle - start < best[0]) best[0] = middle - start;
+    if (end - middle < best[1]) best[1] = end - middle;
+  }
+
+  double baselineNs = best[0] * 1e9 / CALLS;
+  double libraryNs = best[1] * 1e9 / CALLS;
+
+  printf("  %-22s %8.1f ns %8.1f ns  (%.1fx)\n", name, baselineNs, libraryNs,
+         baselineNs / libraryNs);
+  return baselineNs / libraryNs;
+}
+
+/* The baseline's routines, drawing in to `baseline` */
+
+static void baselinePixel(int16_t x, int16_t y, uint8_t color)
+{
+  if (x < 0 || x > (WIDTH-1) || y < 0 || y > (HEIGHT-1))
+  {
+    return;
+  }
+
+  uint16_t row_offset;
+  uint8_t bit;
+
+  bit = 1 << (y & 7);
+  row_offset = (y & 0xF8) * WIDTH / 8 + x;
+  uint8_t data = baseline[row_offset] | bit;
+  if (!color) data ^= bit;
+  baseline[row_offset] = data;
+}
+
+static void baselineFastVLine(int16_t x, int16_t y, uint8_t h, uint8_t color)
+{
+  int end = y+h;
+  for (int a = max(0,y); a < min(end,HEIGHT); a++)
+  {
+    baselinePixel(x,a,color);
+  }
+}
+
+static void baselineFillRect(int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t color)
+{
+  for (int16_t i=x; i<x+w; i++)
+  {
+    baselineFastVLine(i, y, h, color);
+  }
+}
+
+static void baselineFillCircleHelper(int16_t x0, int16_t y0, uint8_t r, uint8_t sides,
+                                     int16_t delta, uint8_t color)
+{
+  int16_t f = 1 - r;
+  int16_t ddF_x = 1;
+  int16_t ddF_y = -2 * r;
+  int16_t x = 0;
+  int16_t y = r;
+
+  while (x < y)
+  {
+    if (f >= 0)
+    {
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+
+    if (sides & 0x1) // right side
+    {
+      baselineFastVLine(x0+x, y0-y, 2*y+1+delta, color);
+      baselineFastVLine(x0+y, y0-x, 2*x+1+delta, color);
+    }
+
+    if (sides & 0x2) // left side
+    {
+      baselineFastVLine(x0-x, y0-y, 2*y+1+delta, color);
+      baselineFastVLine(x0-y, y0-x, 2*x+1+delta, color);
+    }
+  }
+}
+
+static void baselineFillRoundRect(int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t r,
+                                  uint8_t color)
+{
+  baselineFillRect(x+r, y, w-2*r, h, color);
+
+  baselineFillCircleHelper(x+w-r-1, y+r, r, 1, h-2*r-1, color);
+  baselineFillCircleHelper(x+r, y+r, r, 2, h-2*r-1, color);
+}
+
+static void swap(int16_t &a, int16_t &b)
+{
+  int16_t temp = a;
+  a = b;
+  b = temp;
+}
+
+static void baselineFastHLine(int16_t x, int16_t y, uint8_t w, uint8_t color)
+{
+  int16_t xEnd;
+
+  if (y < 0 || y >= HEIGHT)
+    return;
+
+  xEnd = x + w;
+
+  if (xEnd <= 0 || x >= WIDTH)
+    return;
+
+  if (x < 0)
+    x = 0;
+
+  if (xEnd > WIDTH)
+    xEnd = WIDTH;
+
+  w = xEnd - x;
+
+  uint8_t *pBuf = baseline + ((y / 8) * WIDTH) + x;
+
+  uint8_t mask = 1 << (y & 7);
+
+  switch (color)
+  {
+    case WHITE:
+      while (w--)
+      {
+        *pBuf++ |= mask;
+      }
+      break;
+
+    case BLACK:
+      mask = ~mask;
+      while (w--)
+      {
+        *pBuf++ &= mask;
+      }
+      break;
+  }
+}
+
+// fillTriangle(), two divides for each row. Its sums are 16 bit and its spans
+// 8 bit, so it is only drawn near the screen.
+static void baselineFillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                                 int16_t x2, int16_t y2, uint8_t color)
+{
+  int16_t a, b, y, last;
+
+  if (y0 > y1)
+  {
+    swap(y0, y1); swap(x0, x1);
+  }
+  if (y1 > y2)
+  {
+    swap(y2, y1); swap(x2, x1);
+  }
+  if (y0 > y1)
+  {
+    swap(y0, y1); swap(x0, x1);
+  }
+
+  if(y0 == y2)
+  {
+    a = b = x0;
+    if(x1 < a)
+    {
+      a = x1;
+    }
+    else if(x1 > b)
+    {
+      b = x1;
+    }
+    if(x2 < a)
+    {
+      a = x2;
+    }
+    else if(x2 > b)
+    {
+      b = x2;
+    }
+    baselineFastHLine(a, y0, b-a+1, color);
+    return;
+  }
+
+  int16_t dx01 = x1 - x0,
+      dy01 = y1 - y0,
+      dx02 = x2 - x0,
+      dy02 = y2 - y0,
+      dx12 = x2 - x1,
+      dy12 = y2 - y1,
+      sa = 0,
+      sb = 0;
+
+  if (y1 == y2)
+  {
+    last = y1;
+  }
+  else
+  {
+    last = y1-1;
+  }
+
+  for(y = y0; y <= last; y++)
+  {
+    a   = x0 + sa / dy01;
+    b   = x0 + sb / dy02;
+    sa += dx01;
+    sb += dx02;
+
+    if(a > b)
+    {
+      swap(a,b);
+    }
+
+    baselineFastHLine(a, y, b-a+1, color);
+  }
+
+  sa = dx12 * (y - y1);
+  sb = dx02 * (y - y0);
+
+  for(; y <= y2; y++)
+  {
+    a   = x1 + sa / dy12;
+    b   = x0 + sb / dy02;
+    sa += dx12;
+    sb += dx02;
+
+    if(a > b)
+    {
+      swap(a,b);
+    }
+
+    baselineFastHLine(a, y, b-a+1, color);
+  }
+}
+
+static void baselineFillScreen(uint8_t color)
+{
+  if (color != BLACK)
+  {
+    color = 0xFF;
+  }
+  for (int16_t i = 0; i < WIDTH * HEIGHT / 8; i++)
+  {
+     baseline[i] = color;
+  }
+}
+
+// Sprites::drawBitmap(). Its SPRITE_IS_MASK cleared the part of the sprite in
+// the page below and SPRITE_PLUS_MASK drew nothing, so those modes are
+// compared with baselineSpritesB() instead.
+static void baselineSprites(int16_t x, int16_t y, const uint8_t *bitmap, const uint8_t *mask,
+                            uint8_t w, uint8_t h, uint8_t draw_mode)
+{
+  if (x + w <= 0 || x > WIDTH - 1 || y + h <= 0 || y > HEIGHT - 1)
+    return;
+
+  uint16_t xOffset, ofs;
+  int8_t yOffset = y & 7;
+  int8_t sRow = y / 8;
+  uint8_t loop_h, start_h, rendered_width;
+
+  if (y < 0 && yOffset > 0) {
+    sRow--;
+  }
+
+  if (x < 0) {
+    xOffset = abs(x);
+  } else {
+    xOffset = 0;
+  }
+
+  if (x + w > WIDTH - 1) {
+    rendered_width = ((WIDTH - x) - xOffset);
+  } else {
+    rendered_width = (w - xOffset);
+  }
+
+  if (sRow < -1) {
+    start_h = abs(sRow) - 1;
+  } else {
+    start_h = 0;
+  }
+
+  loop_h = h / 8 + (h % 8 > 0 ? 1 : 0);
+
+  if (sRow + loop_h > (HEIGHT / 8)) {
+    loop_h = (HEIGHT / 8) - sRow;
+  }
+
+  loop_h -= start_h;
+
+  sRow += start_h;
+  ofs = (sRow * WIDTH) + x + xOffset;
+  uint8_t *bofs = (uint8_t *)bitmap + (start_h * w) + xOffset;
+  uint8_t data;
+
+  uint8_t mul_amt = 1 << yOffset;
+  uint16_t mask_data;
+  uint16_t bitmap_data;
+
+  switch (draw_mode) {
+    case SPRITE_UNMASKED:
+      mask_data = ~(0xFF * mul_amt);
+      for (uint8_t a = 0; a < loop_h; a++) {
+        for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
+          bitmap_data = pgm_read_byte(bofs) * mul_amt;
+
+          if (sRow >= 0) {
+            data = baseline[ofs];
+            data &= (uint8_t)(mask_data);
+            data |= (uint8_t)(bitmap_data);
+            baseline[ofs] = data;
+          }
+          if (yOffset != 0 && sRow < 7) {
+            uint16_t index = (ofs + WIDTH);
+            data = baseline[index];
+            data &= (*((unsigned char *) (&mask_data) + 1));
+            data |= (*((unsigned char *) (&bitmap_data) + 1));
+            baseline[index] = data;
+          }
+          ofs++;
+          bofs++;
+        }
+        sRow++;
+        bofs += w - rendered_width;
+        ofs += WIDTH - rendered_width;
+      }
+      break;
+
+    case SPRITE_IS_MASK_ERASE:
+      for (uint8_t a = 0; a < loop_h; a++) {
+        for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
+          bitmap_data = pgm_read_byte(bofs) * mul_amt;
+          if (sRow >= 0) {
+            baseline[ofs]  &= ~(uint8_t)(bitmap_data);
+          }
+          if (yOffset != 0 && sRow < 7) {
+            uint16_t index = (ofs + WIDTH);
+            baseline[index] &= ~(reinterpret_cast<const unsigned char *>(&bitmap_data)[1]);
+          }
+          ofs++;
+          bofs++;
+        }
+        sRow++;
+        bofs += w - rendered_width;
+        ofs += WIDTH - rendered_width;
+      }
+      break;
+
+    case SPRITE_MASKED:
+      uint8_t *mask_ofs;
+      mask_ofs = (uint8_t *)mask + (start_h * w) + xOffset;
+      for (uint8_t a = 0; a < loop_h; a++) {
+        for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
+          mask_data = ~(pgm_read_byte(mask_ofs) * mul_amt);
+          bitmap_data = pgm_read_byte(bofs) * mul_amt;
+
+          if (sRow >= 0) {
+            data = baseline[ofs];
+            data &= (uint8_t)(mask_data);
+            data |= (uint8_t)(bitmap_data);
+            baseline[ofs] = data;
+          }
+          if (yOffset != 0 && sRow < 7) {
+            uint16_t index = (ofs + WIDTH);
+            data = baseline[index];
+            data &= (*((unsigned char *) (&mask_data) + 1));
+            data |= (*((unsigned char *) (&bitmap_data) + 1));
+            baseline[index] = data;
+          }
+          ofs++;
+          mask_ofs++;
+          bofs++;
+        }
+        sRow++;
+        bofs += w - rendered_width;
+        mask_ofs += w - rendered_width;
+        ofs += WIDTH - rendered_width;
+      }
+      break;
+  }
+}
+
+// SpritesB::drawBitmap(), every mode in one loop
+static void baselineSpritesB(int16_t x, int16_t y, const uint8_t *bitmap, const uint8_t *mask,
+                             uint8_t w, uint8_t h, uint8_t draw_mode)
+{
+  if (x + w <= 0 || x > WIDTH - 1 || y + h <= 0 || y > HEIGHT - 1)
+    return;
+
+  uint16_t xOffset, ofs;
+  int8_t yOffset = y & 7;
+  int8_t sRow = y / 8;
+  uint8_t loop_h, start_h, rendered_width;
+
+  if (y < 0 && yOffset > 0) {
+    sRow--;
+  }
+
+  if (x < 0) {
+    xOffset = abs(x);
+  } else {
+    xOffset = 0;
+  }
+
+  if (x + w > WIDTH - 1) {
+    rendered_width = ((WIDTH - x) - xOffset);
+  } else {
+    rendered_width = (w - xOffset);
+  }
+
+  if (sRow < -1) {
+    start_h = abs(sRow) - 1;
+  } else {
+    start_h = 0;
+  }
+
+  loop_h = h / 8 + (h % 8 > 0 ? 1 : 0);
+
+  if (sRow + loop_h > (HEIGHT / 8)) {
+    loop_h = (HEIGHT / 8) - sRow;
+  }
+
+  loop_h -= start_h;
+
+  sRow += start_h;
+  ofs = (sRow * WIDTH) + x + xOffset;
+
+  uint8_t mul_amt = 1 << yOffset;
+  uint16_t mask_data;
+  uint16_t bitmap_data;
+
+  const uint8_t ofs_step = draw_mode == SPRITE_PLUS_MASK ? 2 : 1;
+  const uint8_t ofs_stride = (w - rendered_width)*ofs_step;
+  const uint16_t initial_bofs = ((start_h * w) + xOffset)*ofs_step;
+
+  const uint8_t *bofs = bitmap + initial_bofs;
+  const uint8_t *mask_ofs = !mask ? bitmap : mask;
+  mask_ofs += initial_bofs + ofs_step - 1;
+
+  for (uint8_t a = 0; a < loop_h; a++) {
+    for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
+      uint8_t data;
+
+      bitmap_data = pgm_read_byte(bofs) * mul_amt;
+      mask_data = ~bitmap_data;
+
+      if (draw_mode == SPRITE_UNMASKED) {
+        mask_data = ~(0xFF * mul_amt);
+      } else if (draw_mode == SPRITE_IS_MASK_ERASE) {
+        bitmap_data = 0;
+      } else {
+        mask_data = ~(pgm_read_byte(mask_ofs) * mul_amt);
+      }
+
+      if (sRow >= 0) {
+        data = baseline[ofs];
+        data &= (uint8_t)(mask_data);
+        data |= (uint8_t)(bitmap_data);
+        baseline[ofs] = data;
+      }
+      if (yOffset != 0 && sRow < 7) {
+        uint16_t index = (ofs + WIDTH);
+        data = baseline[index];
+        data &= (*((unsigned char *) (&mask_data) + 1));
+        data |= (*((unsigned char *) (&bitmap_data) + 1));
+        baseline[index] = data;
+      }
+      ofs++;
+      mask_ofs += ofs_step;
+      bofs += ofs_step;
+    }
+    sRow++;
+    bofs += ofs_stride;
+    mask_ofs += ofs_stride;
+    ofs += WIDTH - rendered_width;
+  }
+}
+
+// Arduboy2Base::drawBitmap()
+static void baselineDrawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t w, uint8_t h,
+                               uint8_t color)
+{
+  if (x+w < 0 || x > WIDTH-1 || y+h < 0 || y > HEIGHT-1)
+    return;
+
+  int yOffset = abs(y) % 8;
+  int sRow = y / 8;
+  if (y < 0) {
+    sRow--;
+    yOffset = 8 - yOffset;
+  }
+  int rows = h/8;
+  if (h%8!=0) rows++;
+  for (int a = 0; a < rows; a++) {
+    int bRow = sRow + a;
+    if (bRow > (HEIGHT/8)-1) break;
+    if (bRow > -2) {
+      for (int iCol = 0; iCol<w; iCol++) {
+        if (iCol + x > (WIDTH-1)) break;
+        if (iCol + x >= 0) {
+          if (bRow >= 0) {
+            if (color == WHITE)
+              baseline[(bRow*WIDTH) + x + iCol] |= pgm_read_byte(bitmap+(a*w)+iCol) << yOffset;
+            else if (color == BLACK)
+              baseline[(bRow*WIDTH) + x + iCol] &= ~(pgm_read_byte(bitmap+(a*w)+iCol) << yOffset);
+            else
+              baseline[(bRow*WIDTH) + x + iCol] ^= pgm_read_byte(bitmap+(a*w)+iCol) << yOffset;
+          }
+          if (yOffset && bRow<(HEIGHT/8)-1 && bRow > -2) {
+            if (color == WHITE)
+              baseline[((bRow+1)*WIDTH) + x + iCol] |= pgm_read_byte(bitmap+(a*w)+iCol) >> (8-yOffset);
+            else if (color == BLACK)
+              baseline[((bRow+1)*WIDTH) + x + iCol] &= ~(pgm_read_byte(bitmap+(a*w)+iCol) >> (8-yOffset));
+            else
+              baseline[((bRow+1)*WIDTH) + x + iCol] ^= pgm_read_byte(bitmap+(a*w)+iCol) >> (8-yOffset);
+          }
+        }
+      }
+    }
+  }
+}
+
+/* The calls, made the same to each */
+
+struct Fill
+{
+  int16_t x, y;
+  uint8_t w, h;
+  uint8_t color;
+};
+
+static Fill rects[CALLS];
+
+static void fills()
+{
+  printf("fills                       baseline    library\n");
+
+  // anywhere, partly off the screen too
+  for (uint16_t c = 0; c < CALLS; c++)
+  {
+    rects[c].x = randomBetween(-16, WIDTH);
+    rects[c].y = randomBetween(-16, HEIGHT);
+    rects[c].w = randomBetween(1, 48);
+    rects[c].h = randomBetween(1, 48);
+    rects[c].color = randomWord() & 1;
+  }
+  compare("fillRect(), random",
+          [](uint16_t c) { const Fill &r = rects[c]; baselineFillRect(r.x, r.y, r.w, r.h, r.color); },
+          [](uint16_t c) { const Fill &r = rects[c]; arduboy.fillRect(r.x, r.y, r.w, r.h, r.color); });
+
+  compare("fillRect(), screen",
+          [](uint16_t c) { baselineFillRect(0, 0, WIDTH, HEIGHT, c & 1); },
+          [](uint16_t c) { arduboy.fillRect(0, 0, WIDTH, HEIGHT, c & 1); });
+
+  compare("drawFastVLine()",
+          [](uint16_t c) { const Fill &r = rects[c]; baselineFastVLine(r.x, r.y, r.h, r.color); },
+          [](uint16_t c) { const Fill &r = rects[c]; arduboy.drawFastVLine(r.x, r.y, r.h, r.color); });
+
+  compare("fillRoundRect()",
+          [](uint16_t c) { const Fill &r = rects[c]; baselineFillRoundRect(r.x, r.y, r.w, r.h, min(r.w, r.h) / 4, r.color); },
+          [](uint16_t c) { const Fill &r = rects[c]; arduboy.fillRoundRect(r.x, r.y, r.w, r.h, min(r.w, r.h) / 4, r.color); });
+
+  compare("fillScreen()",
+          [](uint16_t c) { baselineFillScreen(c & 1); },
+          [](uint16_t c) { arduboy.fillScreen(c & 1); });
+}
+
+// a sprite, as the Sprites functions take it, its mask and the two
+// interleaved for drawPlusMask()
+struct Sprite
+{
+  uint8_t w, h;
+  uint8_t image[2 + 64 * 4];
+  uint8_t mask[64 * 4];
+  uint8_t plus[2 + 2 * 64 * 4];
+};
+
+static Sprite sprites[2];
+static Sprite hot[4];
+static const Sprite *sprite;
+
+struct Place
+{
+  int16_t x, y;
+};
+
+static Place places[CALLS];
+
+static void makeSprite(Sprite &s, uint8_t w, uint8_t h)
+{
+  uint16_t bytes = w * ((h + 7) / 8);
+
+  s.w = s.image[0] = s.plus[0] = w;
+  s.h = s.image[1] = s.plus[1] = h;
+  for (uint16_t i = 0; i < bytes; i++)
+  {
+    s.mask[i] = randomWord();
+    s.image[2 + i] = randomWord() & s.mask[i];
+    s.plus[2 + 2 * i] = s.image[2 + i];
+    s.plus[3 + 2 * i] = s.mask[i];
+  }
+}
+
+static void draws()
+{
+  makeSprite(sprites[0], 16, 16);
+  makeSprite(sprites[1], 64, 16);
+
+  // anywhere, partly off the screen too
+  for (uint16_t c = 0; c < CALLS; c++)
+  {
+    places[c].x = randomBetween(-24, WIDTH + 8);
+    places[c].y = randomBetween(-24, HEIGHT + 8);
+  }
+
+  for (uint8_t n = 0; n < 2; n++)
+  {
+    sprite = &sprites[n];
+    printf("%ux%u sprites               baseline    library\n", sprite->w, sprite->h);
+
+#define AT(c) places[c].x, places[c].y
+#define SIZE sprite->w, sprite->h
+
+    compare("drawOverwrite()",
+            [](uint16_t c) { baselineSprites(AT(c), sprite->image + 2, NULL, SIZE, SPRITE_OVERWRITE); },
+            [](uint16_t c) { Sprites::drawOverwrite(AT(c), sprite->image, 0); });
+    compare("drawExternalMask()",
+            [](uint16_t c) { baselineSprites(AT(c), sprite->image + 2, sprite->mask, SIZE, SPRITE_MASKED); },
+            [](uint16_t c) { Sprites::drawExternalMask(AT(c), sprite->image, sprite->mask, 0, 0); });
+    compare("drawPlusMask()",
+            [](uint16_t c) { baselineSpritesB(AT(c), sprite->plus + 2, NULL, SIZE, SPRITE_PLUS_MASK); },
+            [](uint16_t c) { Sprites::drawPlusMask(AT(c), sprite->plus, 0); });
+    compare("drawErase()",
+            [](uint16_t c) { baselineSprites(AT(c), sprite->image + 2, NULL, SIZE, SPRITE_IS_MASK_ERASE); },
+            [](uint16_t c) { Sprites::drawErase(AT(c), sprite->image, 0); });
+    compare("drawSelfMasked()",
+            [](uint16_t c) { baselineSpritesB(AT(c), sprite->image + 2, NULL, SIZE, SPRITE_IS_MASK); },
+            [](uint16_t c) { Sprites::drawSelfMasked(AT(c), sprite->image, 0); });
+    compare("SpritesB overwrite",
+            [](uint16_t c) { baselineSpritesB(AT(c), sprite->image + 2, NULL, SIZE, SPRITE_OVERWRITE); },
+            [](uint16_t c) { SpritesB::drawOverwrite(AT(c), sprite->image, 0); });
+    compare("SpritesB external mask",
+            [](uint16_t c) { baselineSpritesB(AT(c), sprite->image + 2, sprite->mask, SIZE, SPRITE_MASKED); },
+            [](uint16_t c) { SpritesB::drawExternalMask(AT(c), sprite->image, sprite->mask, 0, 0); });
+    compare("SpritesB plus mask",
+            [](uint16_t c) { baselineSpritesB(AT(c), sprite->plus + 2, NULL, SIZE, SPRITE_PLUS_MASK); },
+            [](uint16_t c) { SpritesB::drawPlusMask(AT(c), sprite->plus, 0); });
+    compare("drawBitmap(), WHITE",
+            [](uint16_t c) { baselineDrawBitmap(AT(c), sprite->image + 2, SIZE, WHITE); },
+            [](uint16_t c) { Arduboy2Base::drawBitmap(AT(c), sprite->image + 2, SIZE, WHITE); });
+    compare("drawBitmap(), INVERT",
+            [](uint16_t c) { baselineDrawBitmap(AT(c), sprite->image + 2, SIZE, INVERT); },
+            [](uint16_t c) { Arduboy2Base::drawBitmap(AT(c), sprite->image + 2, SIZE, INVERT); });
+
+#undef AT
+#undef SIZE
+  }
+
+  // the kernels for sprites on page rows and wholly on the screen, as games
+  // drawing tiles and most sprites use them
+  sprite = &sprites[0];
+  for (uint16_t c = 0; c < CALLS; c++)
+  {
+    places[c].x = randomBetween(0, WIDTH - sprite->w);
+    places[c].y = randomBetween(0, (HEIGHT - sprite->h) / 8) * 8;
+  }
+  printf("16x16 on page rows          baseline    library\n");
+
+  compare("drawOverwrite()",
+          [](uint16_t c) { baselineSprites(places[c].x, places[c].y, sprite->image + 2, NULL,
+                                           sprite->w, sprite->h, SPRITE_OVERWRITE); },
+          [](uint16_t c) { Sprites::drawOverwrite(places[c].x, places[c].y, sprite->image, 0); });
+  compare("drawExternalMask()",
+          [](uint16_t c) { baselineSprites(places[c].x, places[c].y, sprite->image + 2, sprite->mask,
+                                           sprite->w, sprite->h, SPRITE_MASKED); },
+          [](uint16_t c) { Sprites::drawExternalMask(places[c].x, places[c].y, sprite->image,
+                                                     sprite->mask, 0, 0); });
+  compare("drawPlusMask()",
+          [](uint16_t c) { baselineSpritesB(places[c].x, places[c].y, sprite->plus + 2, NULL,
+                                            sprite->w, sprite->h, SPRITE_PLUS_MASK); },
+          [](uint16_t c) { Sprites::drawPlusMask(places[c].x, places[c].y, sprite->plus, 0); });
+  compare("drawSelfMasked()",
+          [](uint16_t c) { baselineSpritesB(places[c].x, places[c].y, sprite->image + 2, NULL,
+                                            sprite->w, sprite->h, SPRITE_IS_MASK); },
+          [](uint16_t c) { Sprites::drawSelfMasked(places[c].x, places[c].y, sprite->image, 0); });
+}
+
+// Four sprites drawn over and over at Y off the page rows, with the cache of
+// shifted copies at a few sizes: each at the one shift, as sprites moving
+// across the screen, or at any odd one. The baseline shifts every byte each
+// time.
+static uint8_t cache[4096];
+
+static void cached(uint8_t w, uint8_t h, bool anyShift)
+{
+  static const uint16_t budgets[] = { 0, 1024, 4096 };
+
+  for (uint8_t n = 0; n < 4; n++)
+    makeSprite(hot[n], w, h);
+  for (uint16_t c = 0; c < CALLS; c++)
+  {
+    places[c].x = randomBetween(0, WIDTH - w);
+    if (anyShift)
+      places[c].y = randomBetween(0, HEIGHT - h) | 1;
+    else
+      places[c].y = (randomBetween(0, HEIGHT - h - 3) & ~7) + 3;
+  }
+
+  printf("%ux%u masked, %-13s baseline    library\n", w, h,
+         anyShift ? "odd Y" : "Y of 8n + 3");
+  for (uint8_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++)
+  {
+    char name[32];
+
+    Sprites::setCache(budgets[b] ? cache : NULL, budgets[b]);
+    snprintf(name, sizeof(name), "cache of %u bytes", budgets[b]);
+    compare(name,
+            [](uint16_t c) { const Sprite &s = hot[c & 3];
+                             baselineSprites(places[c].x, places[c].y, s.image + 2, s.mask,
+                                             s.w, s.h, SPRITE_MASKED); },
+            [](uint16_t c) { const Sprite &s = hot[c & 3];
+                             Sprites::drawExternalMask(places[c].x, places[c].y, s.image,
+                                                       s.mask, 0, 0); });
+    if (budgets[b])
+      printf("  %-22s %8.1f%% hits\n", "",
+             100.0 * Sprites::cacheHits / (Sprites::cacheHits + Sprites::cacheMisses));
+  }
+  Sprites::setCache(NULL, 0);
+}
+
+// Triangles with their corners near the screen, and some filling it, drawn
+// both ways. Then corners anywhere an int16_t reaches, which the baseline
+// can't draw, only for the sanitizers to watch.
+struct Triangle
+{
+  int16_t x[3], y[3];
+  uint8_t color;
+};
+
+static Triangle triangles[CALLS];
+
+static void nearTriangles(int16_t margin)
+{
+  for (uint16_t c = 0; c < CALLS; c++)
+  {
+    for (uint8_t i = 0; i < 3; i++)
+    {
+      triangles[c].x[i] = randomBetween(-margin, WIDTH - 1 + margin);
+      triangles[c].y[i] = randomBetween(-margin, HEIGHT - 1 + margin);
+    }
+    triangles[c].color = randomWord() & 1;
+  }
+}
+
+static void fillTriangles()
+{
+  printf("triangles                   baseline    library\n");
+
+#define CORNERS(t) t.x[0], t.y[0], t.x[1], t.y[1], t.x[2], t.y[2]
+
+  nearTriangles(16);
+  compare("fillTriangle(), near",
+          [](uint16_t c) { baselineFillTriangle(CORNERS(triangles[c]), triangles[c].color); },
+          [](uint16_t c) { arduboy.fillTriangle(CORNERS(triangles[c]), triangles[c].color); });
+
+  for (uint16_t c = 0; c < CALLS; c++)
+  {
+    Triangle &t = triangles[c];
+
+    t.x[0] = randomBetween(0, 15);
+    t.y[0] = randomBetween(-8, 0);
+    t.x[1] = randomBetween(WIDTH - 16, WIDTH - 1);
+    t.y[1] = randomBetween(0, HEIGHT / 2);
+    t.x[2] = randomBetween(0, WIDTH - 1);
+    t.y[2] = randomBetween(HEIGHT - 1, HEIGHT + 8);
+  }
+  compare("fillTriangle(), large",
+          [](uint16_t c) { baselineFillTriangle(CORNERS(triangles[c]), triangles[c].color); },
+          [](uint16_t c) { arduboy.fillTriangle(CORNERS(triangles[c]), triangles[c].color); });
+
+  for (uint16_t c = 0; c < CALLS; c++)
+  {
+    Triangle &t = triangles[c];
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+      t.x[i] = randomWord();
+      t.y[i] = (i == 2) ? -32768 + (randomWord() & 7) : randomWord();
+    }
+    t.x[c % 3] = (c & 4) ? 32767 : -32768;
+    if (c < 2) // an edge as long and as far above the screen as can be
+    {
+      t.x[0] = c ? 32767 : -32768;
+      t.y[0] = -32768;
+      t.x[1] = c ? -32768 : 32767;
+      t.y[1] = HEIGHT - 1;
+    }
+    arduboy.fillTriangle(CORNERS(t), INVERT);
+  }
+
+#undef CORNERS
+}
+
+int main()
+{
+  fills();
+  draws();
+  cached(16, 16, false);
+  cached(64, 32, false);
+  cached(16, 16, true);
+  cached(64, 32, true);
+  fillTriangles();
+
+  if (failures)
+  {
+    printf("%u differ from the baseline\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,152 @@
+#include <Arduino.h>
+#include <Print.h>
+
+#include "host.h"
+
+// the link pins, as Arduboy2Core.h
+#define DC_BIT   0x40000000
+#define WCLK_BIT 0x10000000
+#define D1_BIT   0x08000000
+#define D0_BIT   0x04000000
+#define LINK_ERROR_BIT 0x00000100
+
+#ifdef LINK_SPIM
+LinkSink hostSink(true); // SERIAL_LINK = 1
+#else
+LinkSink hostSink(false);
+#endif
+uint8_t hostButtons = 0;
+uint32_t hostSpimTransfers = 0;
+uint32_t hostSpimUnguarded = 0;
+volatile uint32_t hostAnomaly198 = 0;
+uint32_t hostPrimask = 0;
+uint32_t hostPortUnlocked = 0;
+
+NRF_GPIO_Type hostP0;
+
+static uint32_t portOut = 0;
+static unsigned long hostMicros = 0;
+static unsigned long randomState = 1;
+
+// a wclk edge passes dc and {d0, d1} to the FPGA
+void hostPortStore(uint32_t out)
+{
+  uint32_t was = portOut;
+
+  portOut = out;
+  hostSink.store();
+
+  if (!(was & WCLK_BIT) && (out & WCLK_BIT))
+    hostSink.rise(out & DC_BIT, ((out & D0_BIT) ? 2 : 0) | ((out & D1_BIT) ? 1 : 0));
+  else if ((was & WCLK_BIT) && !(out & WCLK_BIT))
+    hostSink.fall();
+}
+
+void hostPortWrite(uint32_t out)
+{
+  if (!hostPrimask)
+    hostPortUnlocked++;
+  hostPortStore(out);
+}
+
+uint32_t hostPortOut()
+{
+  return portOut;
+}
+
+uint32_t hostPortIn()
+{
+  return (~hostButtons & 0xFC) | (hostSink.linkError() ? LINK_ERROR_BIT : 0);
+}
+
+void hostAdvance(unsigned long ms)
+{
+  hostMicros += ms * 1000;
+}
+
+void pinMode(uint8_t, uint8_t) { }
+
+unsigned long millis()
+{
+  return hostMicros / 1000;
+}
+
+unsigned long micros()
+{
+  return hostMicros;
+}
+
+void delay(unsigned long ms)
+{
+  hostAdvance(ms);
+}
+
+void randomSeed(unsigned long seed)
+{
+  randomState = seed ? seed : 1;
+}
+
+long random(long howbig)
+{
+  if (howbig <= 0) return 0;
+  randomState = randomState * 1103515245 + 12345;
+  return (long) ((randomState >> 16) & 0x7FFF) % howbig;
+}
+
+long random(long howsmall, long howbig)
+{
+  if (howsmall >= howbig) return howsmall;
+  return random(howbig - howsmall) + howsmall;
+}
+
+/* Print */
+
+size_t Print::write(const char *str)
+{
+  return write((const uint8_t *) str, strlen(str));
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+
+  while (size--) n += write(*buffer++);
+  return n;
+}
+
+size_t Print::printNumber(unsigned long n, int base)
+{
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+
+  *str = '\0';
+  if (base < 2) base = 10;
+  do
+  {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+
+  return write(str);
+}
+
+size_t Print::print(const char str[]) { return write(str); }
+size_t Print::print(char c) { return write((uint8_t) c); }
+size_t Print::print(unsigned char n, int base) { return printNumber(n, base); }
+size_t Print::print(int n, int base) { return print((long) n, base); }
+size_t Print::print(unsigned int n, int base) { return printNumber(n, base); }
+size_t Print::print(unsigned long n, int base) { return printNumber(n, base); }
+
+size_t Print::print(long n, int base)
+{
+  if (base == 10 && n < 0) return write('-') + printNumber(-(unsigned long) n, 10);
+  return printNumber(n, base);
+}
+
+size_t Print::println() { return write("\r\n"); }
+size_t Print::println(const char str[]) { return print(str) + println(); }
+size_t Print::println(int n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned int n, int base) { return print(n, base) + println(); }
+size_t Print::println(long n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned long n, int base) { return print(n, base) + println(); }
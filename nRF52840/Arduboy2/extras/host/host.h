@@ -0,0 +1,27 @@
+// The host harness: the model of the FPGA the library's link drives, the
+// buttons it reads and the time it sees.
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+
+#include "LinkSink.h"
+
+extern LinkSink hostSink;
+
+// SPIM3 transfers started, in the LINK_SPIM build, and those started without
+// the anomaly 198 workaround covering their TXD buffer
+extern uint32_t hostSpimTransfers;
+extern uint32_t hostSpimUnguarded;
+
+// stores to P0 OUT made with interrupts enabled
+extern uint32_t hostPortUnlocked;
+
+// buttons held, as Arduboy2Core::buttonsState()
+extern uint8_t hostButtons;
+
+// move millis() on, delay() does the same
+void hostAdvance(unsigned long ms);
+
+#endif
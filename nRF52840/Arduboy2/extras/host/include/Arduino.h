@@ -0,0 +1,55 @@
+// Host stand-in for the parts of the Arduino nRF52 core the library uses.
+// Time only moves when delay() is called or the harness advances it, so a
+// run is the same every time.
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nrf.h"
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef uint16_t word;
+
+#define INPUT  0
+#define OUTPUT 1
+
+// analog pin numbers of the Adafruit nRF52840 boards, only passed to pinMode()
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+
+#define B00000001 0x01
+#define B00000011 0x03
+#define B01000000 0x40
+#define B10000000 0x80
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+
+#define bit(b) (1UL << (b))
+#define _BV(b) (1 << (b))
+
+template<class A, class B> inline A max(A a, B b) { return (a > (A) b) ? a : (A) b; }
+template<class A, class B> inline A min(A a, B b) { return (a < (A) b) ? a : (A) b; }
+
+void pinMode(uint8_t pin, uint8_t mode);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+void randomSeed(unsigned long seed);
+long random(long howbig);
+long random(long howsmall, long howbig);
+
+#endif
@@ -0,0 +1,48 @@
+// Host stand-in for the Arduino Print class, enough for Arduboy2's text output
+
+#ifndef HOST_PRINT_H
+#define HOST_PRINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// flash is ordinary memory on the nRF52840 too
+class __FlashStringHelper;
+#define F(string) (reinterpret_cast<const __FlashStringHelper *>(string))
+
+class Print
+{
+  public:
+    virtual ~Print() { }
+    virtual size_t write(uint8_t) = 0;
+
+    size_t write(const char *str);
+    size_t write(const uint8_t *buffer, size_t size);
+
+    size_t print(const __FlashStringHelper *str) { return print((const char *) str); }
+    size_t print(const char str[]);
+    size_t print(char c);
+    size_t print(unsigned char n, int base = DEC);
+    size_t print(int n, int base = DEC);
+    size_t print(unsigned int n, int base = DEC);
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+
+    size_t println();
+    size_t println(const __FlashStringHelper *str) { return println((const char *) str); }
+    size_t println(const char str[]);
+    size_t println(int n, int base = DEC);
+    size_t println(unsigned int n, int base = DEC);
+    size_t println(long n, int base = DEC);
+    size_t println(unsigned long n, int base = DEC);
+
+  private:
+    size_t printNumber(unsigned long n, int base);
+};
+
+#endif
@@ -0,0 +1,2 @@
+// Host stand-in: program memory is ordinary memory
+#include <Arduino.h>
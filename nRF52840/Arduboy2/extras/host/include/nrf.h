@@ -0,0 +1,106 @@
+// Host model of the nRF52840 registers the library touches.
+//
+// P0's OUT, OUTSET and OUTCLR are objects whose stores go to hostPortStore()
+// with the new value of OUT, where they are counted and the link pins are
+// passed to the FPGA model. IN reads the buttons set by the harness, active
+// LOW, and the FPGA's link error on P0.08.
+//
+// A store to OUT made with interrupts enabled, PRIMASK clear, is counted too:
+// the GPIO link's stores write every P0 output back.
+//
+// SPIM3 keeps its registers as they are written. A store to TASKS_START goes
+// to hostSpimStart(), and the transfer is clocked in to the FPGA model by a
+// timer signal standing in for the hardware, which then raises EVENTS_END and
+// calls SPIM3_IRQHandler() if the interrupt is enabled. NVIC_DisableIRQ()
+// blocks the signal, so the interrupt waits as it would on the nRF.
+
+#ifndef HOST_NRF_H
+#define HOST_NRF_H
+
+#include <stdint.h>
+
+void hostPortStore(uint32_t out);
+void hostPortWrite(uint32_t out);
+uint32_t hostPortOut();
+uint32_t hostPortIn();
+
+struct HostPortOut
+{
+  HostPortOut &operator=(uint32_t value) { hostPortWrite(value); return *this; }
+  operator uint32_t() const { return hostPortOut(); }
+};
+
+struct HostPortSet
+{
+  HostPortSet &operator=(uint32_t value) { hostPortStore(hostPortOut() | value); return *this; }
+  operator uint32_t() const { return hostPortOut(); }
+};
+
+struct HostPortClear
+{
+  HostPortClear &operator=(uint32_t value) { hostPortStore(hostPortOut() & ~value); return *this; }
+  operator uint32_t() const { return hostPortOut(); }
+};
+
+struct HostPortIn
+{
+  operator uint32_t() const { return hostPortIn(); }
+};
+
+struct NRF_GPIO_Type
+{
+  HostPortOut OUT;
+  HostPortSet OUTSET;
+  HostPortClear OUTCLR;
+  HostPortIn IN;
+};
+
+extern NRF_GPIO_Type hostP0;
+#define NRF_P0 (&hostP0)
+
+void hostSpimStart();
+
+struct HostTask
+{
+  HostTask &operator=(uint32_t value) { if (value) hostSpimStart(); return *this; }
+};
+
+struct NRF_SPIM_Type
+{
+  struct { uint32_t SCK, MOSI, MISO; } PSEL;
+  uint32_t PSELDCX;
+  uint32_t FREQUENCY;
+  uint32_t CONFIG;
+  struct { uintptr_t PTR; uint32_t MAXCNT, AMOUNT; } RXD, TXD;
+  uint32_t DCXCNT;
+  HostTask TASKS_START;
+  volatile uint32_t EVENTS_END;
+  uint32_t INTENSET;
+  uint32_t ENABLE;
+};
+
+extern NRF_SPIM_Type hostSpim3;
+#define NRF_SPIM3 (&hostSpim3)
+
+#define SPIM_INTENSET_END_Msk 0x00000040
+#define SPIM_ENABLE_ENABLE_Enabled 7
+#define SPIM_FREQUENCY_FREQUENCY_M8  0x80000000
+#define SPIM_FREQUENCY_FREQUENCY_M16 0x0A000000
+#define SPIM_FREQUENCY_FREQUENCY_M32 0x14000000
+
+enum IRQn_Type { SPIM3_IRQn = 47 };
+
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+
+extern uint32_t hostPrimask;
+inline uint32_t __get_PRIMASK() { return hostPrimask; }
+inline void __set_PRIMASK(uint32_t primask) { hostPrimask = primask; }
+inline void __disable_irq() { hostPrimask = 1; }
+inline void __enable_irq() { hostPrimask = 0; }
+
+// the register the anomaly 198 workaround writes, at 0x40000E00 on the nRF
+extern volatile uint32_t hostAnomaly198;
+#define NRF_ANOMALY_198 hostAnomaly198
+
+#endif
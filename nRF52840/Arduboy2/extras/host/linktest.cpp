@@ -0,0 +1,507 @@
+// Sends frames through Arduboy2Core's link in to the FPGA model and checks
+// what the GBA would show: full and delta frames, fills, the display mode,
+// refused frames, the button events, a score, a tone and PCM samples. The
+// wclk clocks and port stores of each kind of frame are printed, or the SPIM3
+// transfers when built with LINK_SPIM.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <Arduboy2Core.h>
+
+#include "host.h"
+
+#define BUFFER_BYTES ((WIDTH * HEIGHT) / 8)
+
+// wclk clocks for each two bit symbol, and for a command
+#ifdef LINK_SPIM
+#define SYMBOL_CLOCKS 2
+#else
+#define SYMBOL_CLOCKS 1
+#endif
+#define COMMAND_CLOCKS (12 * SYMBOL_CLOCKS)
+#define EVENT_CLOCKS 192
+
+static uint8_t image[BUFFER_BYTES];
+static unsigned failures = 0;
+static unsigned long seed = 1;
+
+#define CHECK(condition) check(condition, #condition, __LINE__)
+
+static void check(bool condition, const char *text, int line)
+{
+  if (condition) return;
+  printf("FAIL line %d: %s\n", line, text);
+  failures++;
+}
+
+static uint8_t randomByte()
+{
+  seed = seed * 1103515245 + 12345;
+  return seed >> 16;
+}
+
+static bool shown(const uint8_t *expected)
+{
+  uint8_t got[BUFFER_BYTES];
+
+  hostSink.image(hostSink.shownBank, got);
+  return memcmp(got, expected, BUFFER_BYTES) == 0;
+}
+
+// the clocks of the frame just flipped to, and the port stores or SPIM
+// transfers it took
+static void report(const char *name, uint32_t transfers)
+{
+#ifdef LINK_SPIM
+  printf("  %-28s %6u clocks %6u transfers\n", name,
+         (unsigned) hostSink.last.clocks, (unsigned) (hostSpimTransfers - transfers));
+#else
+  printf("  %-28s %6u clocks %6u stores\n", name,
+         (unsigned) hostSink.last.clocks, (unsigned) hostSink.last.stores);
+#endif
+}
+
+// send a frame and check it was accepted and is on the screen
+static void paint(const char *name)
+{
+  uint32_t flips = hostSink.flips;
+  uint32_t transfers = hostSpimTransfers;
+
+  Arduboy2Core::paintScreen(image);
+  Arduboy2Core::waitDisplay();
+
+  CHECK(hostSink.flips == flips + 1);
+  CHECK(hostSink.last.accepted);
+  CHECK(shown(image));
+  CHECK(!hostSink.linkError());
+
+  if (name) report(name, transfers);
+}
+
+static void testFrames()
+{
+  printf("frames\n");
+
+  for (uint16_t i = 0; i < BUFFER_BYTES; i++) image[i] = randomByte();
+  paint("first, whole bank");
+  CHECK(hostSink.last.whole);
+
+  // the first to each of the other two banks is sent whole too
+  paint(NULL);
+  paint(NULL);
+
+  paint("unchanged");
+  CHECK(!hostSink.last.whole);
+
+  image[300] ^= 0x10;
+  paint("one pixel");
+
+  for (uint8_t x = 40; x < 56; x++) image[3 * WIDTH + x] = randomByte();
+  paint("16 columns of a page");
+
+  for (uint16_t i = 0; i < BUFFER_BYTES; i++) image[i] = ~image[i];
+  paint("every pixel changed");
+
+  // scattered changes, each frame checked against the image
+  for (uint16_t frame = 0; frame < 200; frame++)
+  {
+    uint8_t changes = randomByte() % 32;
+
+    for (uint8_t c = 0; c < changes; c++)
+      image[((randomByte() << 8) | randomByte()) % BUFFER_BYTES] ^= 1 << (randomByte() & 7);
+    paint(NULL);
+  }
+}
+
+static void testFill()
+{
+  printf("fill\n");
+
+  uint32_t transfers = hostSpimTransfers;
+
+  Arduboy2Core::blank();
+  Arduboy2Core::waitDisplay();
+  CHECK(hostSink.last.accepted);
+  CHECK(hostSink.last.whole);
+  report("blank", transfers);
+
+  memset(image, 0, sizeof(image));
+  CHECK(shown(image));
+
+  // a delta against the blanked bank
+  image[0] = 0xFF;
+  paint(NULL);
+  paint(NULL);
+  paint(NULL);
+}
+
+static void testMode()
+{
+  printf("mode\n");
+
+  Arduboy2Core::invert(true);
+  Arduboy2Core::waitDisplay();
+  CHECK(hostSink.displayMode == 1);
+  Arduboy2Core::allPixelsOn(true);
+  Arduboy2Core::waitDisplay();
+  CHECK(hostSink.displayMode == 3);
+  Arduboy2Core::invert(false);
+  Arduboy2Core::allPixelsOn(false);
+  Arduboy2Core::waitDisplay();
+  CHECK(hostSink.displayMode == 0);
+
+  paint(NULL); // the mode commands don't upset the check
+}
+
+// a corrupted frame is refused, link error goes HIGH and the next frame is
+// sent whole
+static void testCheck()
+{
+  printf("check\n");
+
+  uint16_t errors = Arduboy2Core::displayErrors();
+  uint8_t before[BUFFER_BYTES];
+  uint8_t shownBank = hostSink.shownBank;
+
+  memcpy(before, image, sizeof(before));
+  image[700] ^= 0x01;
+
+  // the second clock of the pixel data, after CMD_EVENTS, its clocks,
+  // CMD_DELTA and the run header
+  hostSink.corrupt(COMMAND_CLOCKS + EVENT_CLOCKS + COMMAND_CLOCKS + 4 * SYMBOL_CLOCKS + 2);
+  Arduboy2Core::paintScreen(image);
+  Arduboy2Core::waitDisplay();
+
+  CHECK(!hostSink.last.accepted);
+  CHECK(hostSink.shownBank == shownBank);
+  CHECK(shown(before));
+  CHECK(hostSink.linkError());
+  CHECK(hostSink.badFrames == 1);
+
+  // the refused bank is written again, not the one shown
+  uint8_t refused = hostSink.last.bank;
+
+  paint("after a refused frame");
+  CHECK(hostSink.last.whole);
+  CHECK(hostSink.last.bank == refused);
+  CHECK(Arduboy2Core::displayErrors() == errors + 1);
+
+  // the FPGA's counts, sent back before this frame's check
+  DisplayCounts counts = Arduboy2Core::displayCounts();
+
+  CHECK(counts.good == hostSink.goodFrames - 1);
+  CHECK(counts.bad == 1);
+  CHECK(counts.lost == hostSink.lostFrames);
+
+  // none of the banks could be trusted, so the others are sent whole too
+  paint(NULL);
+  CHECK(hostSink.last.whole);
+  paint(NULL);
+  CHECK(hostSink.last.whole);
+
+  image[701] ^= 0x01;
+  paint("then a delta again");
+  CHECK(!hostSink.last.whole);
+  CHECK(hostSink.lostFrames == 0);
+}
+
+// corrupt the frame after the next flip, whatever is still to go out
+static uint8_t corruptAfter = 0;
+
+static void corruptNext()
+{
+  if (corruptAfter && --corruptAfter == 0)
+    hostSink.corrupt(COMMAND_CLOCKS + EVENT_CLOCKS + COMMAND_CLOCKS + 4 * SYMBOL_CLOCKS + 2);
+}
+
+// Frames sent one after another without waiting, so with LINK_SPIM the next
+// is built before the last is known to be taken. One is refused, and none
+// is written in to the bank being shown.
+static void testQueued()
+{
+  printf("queued\n");
+
+  uint32_t shownWrites = hostSink.shownWrites;
+  uint16_t badFrames = hostSink.badFrames;
+
+  hostSink.flipped = corruptNext;
+  corruptAfter = 10;
+  for (uint8_t frame = 0; frame < 30; frame++)
+  {
+    image[(frame * 37) % BUFFER_BYTES] ^= 0x81;
+    Arduboy2Core::paintScreen(image);
+  }
+  Arduboy2Core::waitDisplay();
+  hostSink.flipped = nullptr;
+
+  CHECK(hostSink.badFrames > badFrames);
+  CHECK(hostSink.shownWrites == shownWrites);
+  printf("  %u refused\n", (unsigned) (hostSink.badFrames - badFrames));
+
+  paint(NULL);
+  CHECK(hostSink.shownWrites == shownWrites);
+}
+
+// One clock in every fifth frame is corrupted, anywhere in it. The check
+// covers everything up to and including the CMD_CHECK opcode, CMD_FLIP
+// included, so those frames are refused. A hit on the rest of CMD_CHECK
+// fails it, or loses it, leaving the frame unflipped and the next refused as
+// its check then runs on from this one; those are only counted. Whatever is
+// hit, the GBA only ever shows a frame as it was sent, words a bad address
+// sends to the bank being shown being dropped, and the link recovers.
+static void testFaults()
+{
+  printf("faults\n");
+
+  uint8_t previous[BUFFER_BYTES];
+  uint32_t shownWrites = hostSink.shownWrites;
+  uint32_t injected = 0, refused = 0, checkHits = 0, torn = 0;
+  bool checkHit = false;
+  uint32_t recoveryClocks = 0;
+  uint16_t errors = Arduboy2Core::displayErrors();
+
+  memcpy(previous, image, sizeof(previous));
+
+  // every fifth frame, once the link is sending changes again, somewhere
+  // within the length of the frame before
+  for (uint16_t frame = 0; frame < 5000; frame++)
+  {
+    uint8_t got[BUFFER_BYTES];
+    uint32_t flips = hostSink.flips;
+    bool corrupt = (frame % 5 == 4);
+
+    for (uint8_t c = randomByte() % 8; c > 0; c--)
+      image[((randomByte() << 8) | randomByte()) % BUFFER_BYTES] ^= 1 << (randomByte() & 7);
+
+    if (corrupt)
+      hostSink.corrupt(1 + ((randomByte() << 8) | randomByte()) % hostSink.last.clocks);
+    Arduboy2Core::paintScreen(image);
+    Arduboy2Core::waitDisplay();
+
+    if (!corrupt)
+    {
+      CHECK(hostSink.last.accepted || checkHit);
+      checkHit = false;
+    }
+    else if (hostSink.corruptPending()) // the frame was shorter
+    {
+      hostSink.corrupt(0);
+      CHECK(hostSink.last.accepted);
+    }
+    else
+    {
+      injected++;
+      checkHit = (hostSink.flips == flips ||
+                  hostSink.corruptedAt() > hostSink.last.clocks - COMMAND_CLOCKS);
+      if (checkHit)
+        checkHits++;
+      else
+      {
+        CHECK(!hostSink.last.accepted);
+        if (!hostSink.last.accepted) refused++;
+      }
+    }
+
+    hostSink.image(hostSink.shownBank, got);
+    if (memcmp(got, image, BUFFER_BYTES) == 0)
+      memcpy(previous, image, sizeof(previous));
+    else if (memcmp(got, previous, BUFFER_BYTES) != 0)
+      torn++;
+
+    // the frame after a refusal is sent whole and puts it right
+    if (!hostSink.last.accepted)
+    {
+      paint(NULL);
+      recoveryClocks += hostSink.last.clocks;
+      memcpy(previous, image, sizeof(previous));
+    }
+  }
+
+  // a lost check leaves the next frame to be refused
+  paint(NULL);
+  paint(NULL);
+
+  CHECK(torn == 0);
+  printf("  %u corrupted: %u refused, %u hit the check argument, %u torn on screen\n",
+         (unsigned) injected, (unsigned) refused, (unsigned) checkHits, (unsigned) torn);
+  printf("  %u misaddressed words for the shown bank dropped\n",
+         (unsigned) (hostSink.shownWrites - shownWrites));
+  printf("  %u frames counted as errors, %u lost frame numbers\n",
+         (unsigned) (Arduboy2Core::displayErrors() - errors), (unsigned) hostSink.lostFrames);
+  if (refused)
+    printf("  %u clocks on average for the frame after a refusal\n",
+           (unsigned) (recoveryClocks / refused));
+}
+
+// button changes seen by the GBA come back as events at the next frame
+static void testEvents()
+{
+  printf("events\n");
+
+  static const uint8_t pressed[] = { A_BUTTON, A_BUTTON | LEFT_BUTTON, LEFT_BUTTON, 0 };
+  ButtonEvent events[BUTTON_EVENTS];
+  uint8_t count = BUTTON_EVENTS;
+
+  Arduboy2Core::buttonsState(events, count); // drop any from earlier
+  paint(NULL);
+  count = BUTTON_EVENTS;
+  Arduboy2Core::buttonsState(events, count);
+  CHECK(count == 0);
+
+  // the GBA samples the buttons every ms, as its active LOW bits
+  for (uint8_t time = 0; time < 20; time++)
+  {
+    uint8_t buttons = (time < 16) ? pressed[time / 4] : 0;
+
+    hostSink.buttonSample(time, ~(buttons >> 2) & 0x3F);
+    hostAdvance(1);
+  }
+
+  paint(NULL);
+  count = BUTTON_EVENTS;
+  Arduboy2Core::buttonsState(events, count);
+  CHECK(count == 4);
+  for (uint8_t i = 0; i < count && i < 4; i++)
+  {
+    CHECK(events[i].buttons == pressed[i]);
+    CHECK(events[i].time == millis() - 19 + i * 4);
+  }
+  CHECK(Arduboy2Core::buttonEventsLost() == 0);
+
+  // more than the FPGA sends in a frame
+  for (uint8_t time = 20; time < 40; time++)
+  {
+    hostSink.buttonSample(time, (time & 1) ? 0x3F : 0x3E);
+    hostAdvance(1);
+  }
+  paint(NULL);
+  count = BUTTON_EVENTS;
+  Arduboy2Core::buttonsState(events, count);
+  CHECK(count == BUTTON_EVENTS);
+  CHECK(Arduboy2Core::buttonEventsLost() == 1);
+}
+
+// A score's notes reach the PSG channels with the frames they are due by,
+// and a tone is sent for the square 2 the GBA gives it
+static void testScore()
+{
+  printf("score\n");
+
+  // "Pt" header with volumes, track 0 at half volume and the noise track,
+  // both stopped, then the wave track
+  static const uint8_t score[] =
+  {
+    'P','t', 6, 0x80, 0, 0,
+    0x90,69,64, 0x93,60,127, 0,20,
+    0x80, 0x83, 0,20,
+    0x92,57,32, 0,20,
+    0xf0
+  };
+  uint8_t count0 = hostSink.psgCount[0];
+
+  Arduboy2Core::playScore(score);
+  CHECK(Arduboy2Core::scorePlaying());
+  paint(NULL);
+  CHECK(hostSink.psgNote[0] == (0x8000 | 1750)); // A4, 440 Hz
+  CHECK(hostSink.psgVoice[0] == 0x8080);
+  CHECK(hostSink.psgNote[3] == 0x8061);
+  CHECK(hostSink.psgVoice[3] == 0xF000);
+  CHECK(hostSink.psgCount[0] == ((count0 + 1) & 15));
+
+  // nothing is due, so nothing is sent
+  hostAdvance(10);
+  paint(NULL);
+  CHECK(hostSink.psgCount[0] == ((count0 + 1) & 15));
+
+  hostAdvance(10);
+  paint(NULL);
+  CHECK(hostSink.psgVoice[0] == 0);
+  CHECK(hostSink.psgVoice[3] == 0);
+  CHECK(hostSink.psgCount[0] == ((count0 + 2) & 15));
+
+  hostAdvance(20);
+  paint(NULL);
+  CHECK(hostSink.psgNote[2] == (0x8000 | 1750)); // A3 on 32 samples
+  CHECK(hostSink.psgVoice[2] == 0x4080);
+
+  hostAdvance(20);
+  paint(NULL);
+  CHECK(!Arduboy2Core::scorePlaying());
+  CHECK(hostSink.psgVoice[2] == 0);
+
+  // a tone, muted as timer() runs it out
+  Arduboy2Core::tone(1750, 3);
+  paint(NULL);
+  CHECK(hostSink.sound == 0xF6D6);
+  Arduboy2Core::timer();
+  Arduboy2Core::timer();
+  paint(NULL);
+  CHECK(hostSink.sound == 0x06D6);
+}
+
+// PCM samples reach the FIFO in pairs, the first in the low byte
+static void testPcm()
+{
+  printf("pcm\n");
+
+  int8_t samples[100];
+  for (uint8_t i = 0; i < sizeof(samples); i++) samples[i] = i * 2 - 100;
+
+  CHECK(Arduboy2Core::pcmWrite(samples, sizeof(samples)) == sizeof(samples));
+  paint(NULL);
+  CHECK(hostSink.pcmLevel() == sizeof(samples) / 2);
+  CHECK(Arduboy2Core::pcmWanted() == 512 - sizeof(samples));
+
+  bool same = true;
+  for (uint8_t i = 0; i < sizeof(samples); i += 2)
+  {
+    uint16_t pair = hostSink.pcmRead();
+
+    same = same && (int8_t) (pair & 0xFF) == samples[i] && (int8_t) (pair >> 8) == samples[i + 1];
+  }
+  CHECK(same);
+  CHECK(hostSink.pcmLevel() == 0);
+
+  // the FPGA reports the FIFO drained
+  paint(NULL);
+  CHECK(Arduboy2Core::pcmWanted() == 512);
+}
+
+int main()
+{
+  Arduboy2Core::boot();
+  hostSink.clocks = 0; // the clock aligning the commands
+  hostSink.stores = 0;
+
+  testFrames();
+  testFill();
+  testMode();
+  testCheck();
+  testQueued();
+  testEvents();
+  testScore();
+  testPcm();
+
+  printf("%u frames, %u refused, %u words sent to the shown bank\n",
+         (unsigned) hostSink.flips, (unsigned) hostSink.badFrames,
+         (unsigned) hostSink.shownWrites);
+  CHECK(hostSink.shownWrites == 0);
+#ifdef LINK_SPIM
+  CHECK(hostSpimUnguarded == 0);
+  CHECK(hostAnomaly198 == 0);
+#else
+  CHECK(hostPortUnlocked == 0);
+#endif
+  CHECK(hostPrimask == 0);
+
+  testFaults();
+
+  if (failures)
+  {
+    printf("%u FAILED\n", failures);
+    return 1;
+  }
+  printf("passed\n");
+  return 0;
+}
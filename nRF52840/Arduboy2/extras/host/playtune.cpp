@@ -0,0 +1,101 @@
+// Plays the PlayTune example on the host and checks what the GBA is sent:
+// the score's two parts on the square channels, a tone and a PCM click for a
+// D-pad press, and silence once the A button mutes it, until B turns the
+// sound back on. The score starts after the boot logo, its second part about
+// two seconds in.
+
+#include "sketch.h"
+#include "host.h"
+
+HostEEPROM EEPROM;
+
+void playTone(uint8_t button, uint16_t note);
+
+#include "../../examples/PlayTune/PlayTune.ino"
+
+#define PRESS_FROM_MS 5000
+#define MUTE_FROM_MS 7000
+#define SOUND_FROM_MS 9000
+#define END_MS 13000
+
+static uint32_t notes[LinkSink::PSG_CHANNELS]; // CMD_NOTE sent, in each span
+static uint8_t lastCount[LinkSink::PSG_CHANNELS];
+static uint32_t toneFrames = 0;
+static uint32_t pcmWords = 0;
+static bool voiced = false; // a channel sounded while muted
+
+static void flipped()
+{
+  for (uint8_t channel = 0; channel < LinkSink::PSG_CHANNELS; channel++)
+  {
+    notes[channel] += (hostSink.psgCount[channel] - lastCount[channel]) & 15;
+    lastCount[channel] = hostSink.psgCount[channel];
+  }
+
+  if (hostSink.sound & 0xF000) toneFrames++;
+  while (hostSink.pcmLevel())
+  {
+    hostSink.pcmRead();
+    pcmWords++;
+  }
+
+  if (millis() >= MUTE_FROM_MS + 100 && millis() < SOUND_FROM_MS)
+    voiced = voiced || hostSink.psgVoice[0] || hostSink.psgVoice[1];
+}
+
+// run the sketch to the given time, and return the notes sent on each
+// square channel
+static void run(unsigned long until, uint32_t sent[2])
+{
+  memset(notes, 0, sizeof(notes));
+  while (millis() < until)
+  {
+    loop();
+    hostAdvance(1);
+  }
+  sent[0] = notes[0];
+  sent[1] = notes[1];
+}
+
+int main()
+{
+  unsigned failures = 0;
+  uint32_t sent[2];
+
+  hostSink.flipped = flipped;
+  setup();
+
+  run(PRESS_FROM_MS, sent);
+  printf("score:  %u and %u notes on the squares\n", (unsigned) sent[0], (unsigned) sent[1]);
+  if (sent[0] == 0 || sent[1] == 0 || toneFrames != 0 || pcmWords != 0) failures++;
+
+  hostButtons = RIGHT_BUTTON;
+  run(PRESS_FROM_MS + 500, sent);
+  hostButtons = 0;
+  run(MUTE_FROM_MS, sent);
+  printf("press:  %u frames of tone, %u PCM samples\n", (unsigned) toneFrames, (unsigned) pcmWords * 2);
+  if (toneFrames == 0 || pcmWords * 2 != CLICK_SAMPLES) failures++;
+
+  hostButtons = A_BUTTON;
+  run(MUTE_FROM_MS + 100, sent);
+  hostButtons = 0;
+  run(SOUND_FROM_MS, sent);
+  printf("muted:  %u and %u notes, %s\n", (unsigned) sent[0], (unsigned) sent[1],
+         voiced ? "sounding" : "silent");
+  if (arduboy.scorePlaying() || sent[0] || sent[1] || voiced) failures++;
+
+  hostButtons = B_BUTTON;
+  run(SOUND_FROM_MS + 100, sent);
+  hostButtons = 0;
+  run(END_MS, sent);
+  printf("sound:  %u and %u notes on the squares\n", (unsigned) sent[0], (unsigned) sent[1]);
+  if (sent[0] == 0 || sent[1] == 0) failures++;
+
+  if (failures)
+  {
+    printf("%u FAILED\n", failures);
+    return 1;
+  }
+  printf("passed\n");
+  return 0;
+}
@@ -0,0 +1,100 @@
+// Plays ArduBreakout on the host and writes each frame the GBA is sent to a
+// file, for replay. The title screen runs for a few seconds, then the paddle
+// follows the ball, apart from a spell where it is left still so the game
+// is lost and the high score screens come up.
+//
+//   record <file> [frames]
+
+#include "sketch.h"
+#include "host.h"
+
+HostEEPROM EEPROM;
+
+// the sketch's functions, declared as the Arduino IDE would
+void movePaddle();
+void moveBall();
+void drawBall();
+void drawPaddle();
+void drawGameOver();
+void pause();
+void Score();
+void newLevel();
+boolean pollFireButton(int n);
+boolean displayHighScores(byte file);
+boolean titleScreen();
+void enterInitials();
+void enterHighScore(byte file);
+void playTone(unsigned int frequency, unsigned int duration);
+void playToneTimed(unsigned int frequency, unsigned int duration);
+
+#include "../../examples/ArduBreakout/ArduBreakout.ino"
+
+#define TITLE_MS 3000
+#define IDLE_FROM_MS 40000
+#define IDLE_TO_MS 55000
+
+static FILE *out;
+static uint32_t recorded = 0;
+static uint32_t frames;
+
+// FIRE is released and pressed again on alternate frames, as the sketch
+// waits for it to be pressed rather than held
+static void steer()
+{
+  unsigned long now = millis();
+  bool fire = !start || !released || lives == 0;
+  uint8_t buttons = 0;
+
+  if (now < TITLE_MS) fire = false;
+  else if (now >= IDLE_FROM_MS && now < IDLE_TO_MS) fire = fire && !released;
+  else if (xPaddle + 5 < xb) buttons = RIGHT_BUTTON;
+  else if (xPaddle + 5 > xb + 1) buttons = LEFT_BUTTON;
+
+  if (fire && (recorded & 1)) buttons |= A_BUTTON;
+  hostButtons = buttons;
+}
+
+static void flipped()
+{
+  uint8_t image[(WIDTH * HEIGHT) / 8];
+
+  if (recorded < frames)
+  {
+    hostSink.image(hostSink.shownBank, image);
+    fwrite(image, sizeof(image), 1, out);
+    recorded++;
+  }
+  steer();
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: %s <file> [frames]\n", argv[0]);
+    return 2;
+  }
+  frames = (argc > 2) ? atoi(argv[2]) : 3600;
+
+  out = fopen(argv[1], "wb");
+  if (!out)
+  {
+    perror(argv[1]);
+    return 1;
+  }
+
+  hostSink.flipped = flipped;
+  setup();
+  randomSeed(1); // generateRandomSeed() has no entropy here
+
+  while (recorded < frames)
+  {
+    loop();
+    hostAdvance(1);
+  }
+
+  fclose(out);
+  printf("%u frames recorded over %lu ms, score %u, level %u, %u lives\n",
+         (unsigned) recorded, millis(), score, level, lives);
+  return 0;
+}
@@ -0,0 +1,127 @@
+// Sends recorded frames through paintScreen() and reports the link clocks
+// each took, against sending every frame whole, and the host time the call
+// held the sketch for. With LINK_SPIM that is building the frame, the
+// transfer going on after it returns. With GPIO it is the whole send, but
+// the port stores are only counted here, so the time on the nRF is longer.
+//
+//   replay <file>
+
+#include <algorithm>
+#include <vector>
+
+#include <time.h>
+
+#include <Arduboy2Core.h>
+
+#include "host.h"
+
+#define BUFFER_BYTES ((WIDTH * HEIGHT) / 8)
+
+static uint64_t nanoseconds()
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// clocks a whole frame takes with no PCM or PSG commands
+#ifdef LINK_SPIM
+#define WHOLE_CLOCKS 8568
+#else
+#define WHOLE_CLOCKS 4380
+#endif
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: %s <file>\n", argv[0]);
+    return 2;
+  }
+
+  FILE *in = fopen(argv[1], "rb");
+  if (!in)
+  {
+    perror(argv[1]);
+    return 1;
+  }
+
+  std::vector<uint8_t> frames;
+  uint8_t image[BUFFER_BYTES];
+
+  while (fread(image, sizeof(image), 1, in) == 1)
+    frames.insert(frames.end(), image, image + sizeof(image));
+  fclose(in);
+
+  size_t count = frames.size() / BUFFER_BYTES;
+  std::vector<uint32_t> clocks;
+  std::vector<uint32_t> held;
+  uint64_t totalClocks = 0;
+  uint64_t totalStores = 0;
+  uint32_t whole = 0;
+  unsigned failures = 0;
+
+  Arduboy2Core::boot();
+  hostSink.clocks = 0; // the clock aligning the commands
+  hostSink.stores = 0;
+
+  for (size_t f = 0; f < count; f++)
+  {
+    uint8_t shown[BUFFER_BYTES];
+
+    memcpy(image, &frames[f * BUFFER_BYTES], BUFFER_BYTES);
+    uint64_t start = nanoseconds();
+    Arduboy2Core::paintScreen(image);
+    held.push_back(nanoseconds() - start);
+    Arduboy2Core::waitDisplay();
+
+    hostSink.image(hostSink.shownBank, shown);
+    if (!hostSink.last.accepted || memcmp(shown, image, BUFFER_BYTES) != 0)
+      failures++;
+
+    clocks.push_back(hostSink.last.clocks);
+    totalClocks += hostSink.last.clocks;
+    totalStores += hostSink.last.stores;
+    if (hostSink.last.whole) whole++;
+  }
+
+  if (count == 0)
+  {
+    printf("no frames in %s\n", argv[1]);
+    return 1;
+  }
+
+  std::vector<uint32_t> sorted(clocks);
+  std::sort(sorted.begin(), sorted.end());
+  std::sort(held.begin(), held.end());
+
+  double mean = (double) totalClocks / count;
+
+#ifdef LINK_SPIM
+  printf("SPIM3, one bit per clock\n");
+#else
+  printf("GPIO, two bits per clock\n");
+#endif
+  printf("  frames                %8u (%u sent whole)\n", (unsigned) count, (unsigned) whole);
+  printf("  clocks per frame      %8.1f mean, %u median, %u 95th, %u max\n", mean,
+         (unsigned) sorted[count / 2], (unsigned) sorted[(count * 95) / 100],
+         (unsigned) sorted[count - 1]);
+  printf("  against whole frames  %8.1f%%\n", 100.0 * mean / WHOLE_CLOCKS);
+  printf("  paintScreen() held    %8u ns median, %u ns 95th (host)\n",
+         (unsigned) held[count / 2], (unsigned) held[(count * 95) / 100]);
+#ifdef LINK_SPIM
+  printf("  transfers per frame   %8.2f\n", (double) hostSpimTransfers / count);
+  printf("  at 8 MHz              %8.1f us mean, %.1f us max\n", mean / 8,
+         sorted[count - 1] / 8.0);
+#else
+  printf("  port stores per frame %8.1f\n", (double) totalStores / count);
+#endif
+
+  if (failures)
+  {
+    printf("%u frames not shown as sent\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,33 @@
+// Included ahead of a sketch built on the host: what the examples use from
+// outside the library. BeepPin1 is silent and EEPROM starts erased.
+
+#ifndef HOST_SKETCH_H
+#define HOST_SKETCH_H
+
+#include <Arduboy2.h>
+
+class BeepPin1
+{
+  public:
+    static void begin() { }
+    static void timer() { }
+    static void tone(uint16_t count, uint8_t dur = 0) { }
+    static void noTone() { }
+    static uint16_t freq(float hz) { return (uint16_t) (1000000 / hz) - 1; }
+};
+
+class HostEEPROM
+{
+  public:
+    HostEEPROM() { memset(data, 0xFF, sizeof(data)); }
+    uint8_t read(int address) { return data[address % sizeof(data)]; }
+    void update(int address, uint8_t value) { data[address % sizeof(data)] = value; }
+    void write(int address, uint8_t value) { update(address, value); }
+
+  private:
+    uint8_t data[1024];
+};
+
+extern HostEEPROM EEPROM;
+
+#endif
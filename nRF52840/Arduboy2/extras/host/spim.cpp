@@ -0,0 +1,108 @@
+// SPIM3, for the LINK_SPIM build. A transfer started by TASKS_START is
+// clocked in to the FPGA model at the next tick of a timer signal, which
+// stands in for the hardware running beside the CPU.
+
+#include <signal.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <Arduino.h>
+
+#include "host.h"
+
+#define TICK_US 20
+#define DCX_WHOLE 0xF // DCXCNT: dc LOW for all of the transfer
+
+extern "C" void SPIM3_IRQHandler(void);
+
+NRF_SPIM_Type hostSpim3;
+
+static volatile bool running = false;
+static const uint8_t *txData;
+static uint32_t txCount;
+static uint8_t *rxData;
+static uint32_t rxCount;
+static uint32_t dcxCount;
+
+// the registers are taken as the task starts, as the hardware does
+void hostSpimStart()
+{
+  txData = (const uint8_t *) NRF_SPIM3->TXD.PTR;
+  txCount = NRF_SPIM3->TXD.MAXCNT;
+  rxData = (uint8_t *) NRF_SPIM3->RXD.PTR;
+  rxCount = NRF_SPIM3->RXD.MAXCNT;
+  dcxCount = NRF_SPIM3->DCXCNT;
+  hostSpimTransfers++;
+  if (hostAnomaly198 == 0)
+    hostSpimUnguarded++;
+  running = true;
+}
+
+// MSB first on MOSI (d0), mode 0: MISO (link error) is taken as wclk rises,
+// the FPGA having changed it as wclk fell
+static void clockOut()
+{
+  for (uint32_t i = 0; i < txCount; i++)
+  {
+    bool dc = (dcxCount != DCX_WHOLE) && (i >= dcxCount);
+    uint8_t in = 0;
+
+    for (int8_t b = 7; b >= 0; b--)
+    {
+      hostSink.fall();
+      in = (in << 1) | (hostSink.linkError() ? 1 : 0);
+      hostSink.rise(dc, ((txData[i] >> b) & 1) << 1);
+    }
+    if (i < rxCount) rxData[i] = in;
+  }
+  NRF_SPIM3->TXD.AMOUNT = txCount;
+  NRF_SPIM3->RXD.AMOUNT = rxCount;
+}
+
+static void tick(int)
+{
+  if (!running) return;
+
+  running = false;
+  clockOut();
+  NRF_SPIM3->EVENTS_END = 1;
+  if (NRF_SPIM3->INTENSET & SPIM_INTENSET_END_Msk) SPIM3_IRQHandler();
+}
+
+static void mask(int how)
+{
+  sigset_t set;
+
+  sigemptyset(&set);
+  sigaddset(&set, SIGALRM);
+  sigprocmask(how, &set, NULL);
+}
+
+void NVIC_EnableIRQ(IRQn_Type)
+{
+  static bool ticking = false;
+
+  if (!ticking)
+  {
+    struct sigaction action;
+    struct itimerval timer;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = tick;
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGALRM, &action, NULL);
+
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = TICK_US;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_REAL, &timer, NULL);
+    ticking = true;
+  }
+
+  mask(SIG_UNBLOCK);
+}
+
+void NVIC_DisableIRQ(IRQn_Type)
+{
+  mask(SIG_BLOCK);
+}
@@ -5,6 +5,7 @@
  */
 
 #include "Arduboy2.h"
+#include "SpritesBlit.h"
 #include "ab_logo.c"
 #include "glcdfont.c"
 
@@ -413,85 +414,101 @@ void Arduboy2Base::drawRect
 void Arduboy2Base::drawFastVLine
 (int16_t x, int16_t y, uint8_t h, uint8_t color)
 {
-  int end = y+h;
-  for (int a = max(0,y); a < min(end,HEIGHT); a++)
-  {
-    drawPixel(x,a,color);
-  }
+  fillSpan(x, y, 1, h, color);
 }
 
 void Arduboy2Base::drawFastHLine
 (int16_t x, int16_t y, uint8_t w, uint8_t color)
 {
-  int16_t xEnd; // last x point + 1
+  fillSpan(x, y, w, 1, color);
+}
 
-  // Do y bounds checks
-  if (y < 0 || y >= HEIGHT)
-    return;
+// A word with the same byte in each of its four, stored over the buffer's
+// bytes
+typedef uint32_t __attribute__((__may_alias__)) spanWord;
 
-  xEnd = x + w;
+// Apply a mask to w bytes of one page: set, clear or invert its bits. Whole
+// bytes set or cleared are left to memset(), otherwise the bytes between the
+// first and last word boundaries are done four at a time.
+static void fillPageSpan(uint8_t *pBuf, int16_t w, uint8_t mask, uint8_t color)
+{
+  uint8_t keep = (color == INVERT) ? 0xFF : ~mask; // bits left as they are
+  uint8_t set = (color == BLACK || color == INVERT) ? 0 : mask;
+  uint8_t flip = (color == INVERT) ? mask : 0;
 
-  // Check if the entire line is not on the display
-  if (xEnd <= 0 || x >= WIDTH)
+  if (keep == 0) // the whole byte is written
+  {
+    if (w > 0)
+      memset(pBuf, set, w);
     return;
+  }
 
-  // Don't start before the left edge
-  if (x < 0)
-    x = 0;
+  while (w > 0 && ((uintptr_t) pBuf & 3))
+  {
+    *pBuf = ((*pBuf & keep) | set) ^ flip;
+    pBuf++;
+    w--;
+  }
 
-  // Don't end past the right edge
-  if (xEnd > WIDTH)
-    xEnd = WIDTH;
+  spanWord *pWord = (spanWord *) pBuf;
+  spanWord keep4 = keep * 0x01010101UL;
+  spanWord set4 = set * 0x01010101UL;
+  spanWord flip4 = flip * 0x01010101UL;
 
-  // calculate actual width (even if unchanged)
-  w = xEnd - x;
+  for (; w >= 4; w -= 4)
+  {
+    *pWord = ((*pWord & keep4) | set4) ^ flip4;
+    pWord++;
+  }
 
-  // buffer pointer plus row offset + x offset
-  register uint8_t *pBuf = sBuffer + ((y / 8) * WIDTH) + x;
+  pBuf = (uint8_t *) pWord;
+  while (w-- > 0)
+  {
+    *pBuf = ((*pBuf & keep) | set) ^ flip;
+    pBuf++;
+  }
+}
+
+void Arduboy2Base::fillSpan
+(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t color)
+{
+  int16_t xEnd = x + w; // last x point + 1
+  int16_t yEnd = y + h; // last y point + 1
+
+  // clip once to the display
+  if (x < 0) x = 0;
+  if (y < 0) y = 0;
+  if (xEnd > WIDTH) xEnd = WIDTH;
+  if (yEnd > HEIGHT) yEnd = HEIGHT;
+  if (x >= xEnd || y >= yEnd)
+    return;
 
-  // pixel mask
-  register uint8_t mask = 1 << (y & 7);
+  uint8_t page = y / 8;
+  uint8_t lastPage = (yEnd - 1) / 8;
+  uint8_t topMask = 0xFF << (y & 7);
+  uint8_t bottomMask = 0xFF >> (7 - ((yEnd - 1) & 7));
 
-  switch (color)
+  for (; page <= lastPage; page++)
   {
-    case WHITE:
-      while (w--)
-      {
-        *pBuf++ |= mask;
-      }
-      break;
+    uint8_t mask = 0xFF;
 
-    case BLACK:
-      mask = ~mask;
-      while (w--)
-      {
-        *pBuf++ &= mask;
-      }
-      break;
+    if (page == y / 8) mask &= topMask;
+    if (page == lastPage) mask &= bottomMask;
+
+    fillPageSpan(sBuffer + (page * WIDTH) + x, xEnd - x, mask, color);
   }
 }
 
 void Arduboy2Base::fillRect
 (int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t color)
 {
-  // stupidest version - update in subclasses if desired!
-  for (int16_t i=x; i<x+w; i++)
-  {
-    drawFastVLine(i, y, h, color);
-  }
+  fillSpan(x, y, w, h, color);
 }
 
 void Arduboy2Base::fillScreen(uint8_t color)
 {
-  // C version:
-  if (color != BLACK)
-  {
-    color = 0xFF; // all pixels on
-  }
-  for (int16_t i = 0; i < WIDTH * HEIGHT / 8; i++)
-  {
-     sBuffer[i] = color;
-  }
+  // the pages follow on from each other, so the buffer is one span
+  fillPageSpan(sBuffer, sizeof(sBuffer), 0xFF, (color != BLACK) ? WHITE : BLACK);
 }
 
 void Arduboy2Base::drawRoundRect
@@ -528,106 +545,172 @@ void Arduboy2Base::drawTriangle
   drawLine(x2, y2, x0, y0, color);
 }
 
-void Arduboy2Base::fillTriangle
-(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t color)
+// Filled triangles and polygons are drawn from the span of columns they
+// cover on each row. Each edge is stepped down the rows from its upper end,
+// its X kept as a whole part and a remainder so that there are no divides
+// after the first row, and widens each row's span to reach it. The spans are
+// then drawn a page at a time: the columns every row of the page covers as
+// whole bytes, and each column of the ragged ends as the byte of the rows
+// that reach it.
+struct RowSpans
 {
+  int16_t left[HEIGHT];
+  int16_t right[HEIGHT];
+  int16_t top; // rows with a span
+  int16_t bottom;
+};
 
-  int16_t a, b, y, last;
-  // Sort coordinates by Y order (y2 >= y1 >= y0)
-  if (y0 > y1)
+static void rowSpansBegin(RowSpans &spans)
+{
+  for (uint8_t y = 0; y < HEIGHT; y++)
   {
-    swap(y0, y1); swap(x0, x1);
+    spans.left[y] = WIDTH;
+    spans.right[y] = -1;
   }
-  if (y1 > y2)
+  spans.top = HEIGHT;
+  spans.bottom = -1;
+}
+
+static inline void rowSpansAdd(RowSpans &spans, int16_t y, int32_t x)
+{
+  if (x < -1) x = -1; // just off the screen
+  if (x > WIDTH) x = WIDTH;
+  if (x < spans.left[y]) spans.left[y] = x;
+  if (x > spans.right[y]) spans.right[y] = x;
+  if (y < spans.top) spans.top = y;
+  if (y > spans.bottom) spans.bottom = y;
+}
+
+static void rowSpansEdge
+(RowSpans &spans, int16_t x0, int16_t y0, int16_t x1, int16_t y1)
+{
+  if (y0 > y1) // step down from the upper end
   {
-    swap(y2, y1); swap(x2, x1);
+    int16_t t = x0; x0 = x1; x1 = t;
+    t = y0; y0 = y1; y1 = t;
   }
-  if (y0 > y1)
+  if (y1 < 0 || y0 >= HEIGHT)
+    return;
+
+  if (y0 == y1)
   {
-    swap(y0, y1); swap(x0, x1);
+    rowSpansAdd(spans, y0, x0);
+    rowSpansAdd(spans, y0, x1);
+    return;
   }
 
-  if(y0 == y2)
-  { // Handle awkward all-on-same-line case as its own thing
-    a = b = x0;
-    if(x1 < a)
-    {
-      a = x1;
-    }
-    else if(x1 > b)
-    {
-      b = x1;
-    }
-    if(x2 < a)
-    {
-      a = x2;
-    }
-    else if(x2 > b)
+  // x = x0 + dx * (y - y0) / dy, rounded towards x0. For any int16_t corners
+  // dx is at most 65535 and y - y0 at most 32768, as y starts at 0 or y0, so
+  // the product fits in an int32_t.
+  int32_t dx = (x1 > x0) ? x1 - x0 : x0 - x1;
+  int32_t dy = y1 - y0;
+  int8_t sign = (x1 > x0) ? 1 : -1;
+  int16_t y = (y0 < 0) ? 0 : y0;
+  int16_t end = (y1 >= HEIGHT) ? HEIGHT - 1 : y1;
+  int32_t whole = (dx * (y - y0)) / dy;
+  int32_t part = (dx * (y - y0)) % dy;
+  int32_t stepWhole = dx / dy;
+  int32_t stepPart = dx % dy;
+
+  for (; y <= end; y++)
+  {
+    rowSpansAdd(spans, y, x0 + sign * whole);
+    whole += stepWhole;
+    part += stepPart;
+    if (part >= dy)
     {
-      b = x2;
+      whole++;
+      part -= dy;
     }
-    drawFastHLine(a, y0, b-a+1, color);
-    return;
   }
+}
 
-  int16_t dx01 = x1 - x0,
-      dy01 = y1 - y0,
-      dx02 = x2 - x0,
-      dy02 = y2 - y0,
-      dx12 = x2 - x1,
-      dy12 = y2 - y1,
-      sa = 0,
-      sb = 0;
-
-  // For upper part of triangle, find scanline crossings for segments
-  // 0-1 and 0-2.  If y1=y2 (flat-bottomed triangle), the scanline y1
-  // is included here (and second loop will be skipped, avoiding a /0
-  // error there), otherwise scanline y1 is skipped here and handled
-  // in the second loop...which also avoids a /0 error here if y0=y1
-  // (flat-topped triangle).
-  if (y1 == y2)
-  {
-    last = y1;   // Include y1 scanline
-  }
+void Arduboy2Base::fillTriangle
+(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t color)
+{
+  Point corners[3] = { Point(x0, y0), Point(x1, y1), Point(x2, y2) };
+
+  fillPolygon(corners, 3, color);
+}
+
+static inline void fillColumnByte(uint8_t *pBuf, uint8_t bits, uint8_t color)
+{
+  if (color == BLACK)
+    *pBuf &= ~bits;
+  else if (color == INVERT)
+    *pBuf ^= bits;
   else
-  {
-    last = y1-1; // Skip it
-  }
+    *pBuf |= bits;
+}
 
+void Arduboy2Base::fillPolygon(const Point points[], uint8_t count, uint8_t color)
+{
+  RowSpans spans;
+  // the rows starting or ending at each column of a page, with each row's
+  // bit toggled at its first column and after its last
+  uint8_t toggles[WIDTH + 1];
 
-  for(y = y0; y <= last; y++)
-  {
-    a   = x0 + sa / dy01;
-    b   = x0 + sb / dy02;
-    sa += dx01;
-    sb += dx02;
+  if (count == 0)
+    return;
 
-    if(a > b)
-    {
-      swap(a,b);
-    }
+  rowSpansBegin(spans);
+  for (uint8_t i = 0; i < count; i++)
+  {
+    const Point &a = points[i];
+    const Point &b = points[(i + 1) % count];
 
-    drawFastHLine(a, y, b-a+1, color);
+    rowSpansEdge(spans, a.x, a.y, b.x, b.y);
   }
+  if (spans.top > spans.bottom)
+    return;
 
-  // For lower part of triangle, find scanline crossings for segments
-  // 0-2 and 1-2.  This loop is skipped if y1=y2.
-  sa = dx12 * (y - y1);
-  sb = dx02 * (y - y0);
-
-  for(; y <= y2; y++)
+  memset(toggles, 0, sizeof(toggles));
+  for (uint8_t page = spans.top / 8; page <= spans.bottom / 8; page++)
   {
-    a   = x1 + sa / dy12;
-    b   = x0 + sb / dy02;
-    sa += dx12;
-    sb += dx02;
-
-    if(a > b)
+    uint8_t *pBuf = sBuffer + (page * WIDTH);
+    uint8_t rows = 0;          // a bit for each row of the page with a span
+    int16_t inLeft = 0;        // the columns all of them cover
+    int16_t inRight = WIDTH - 1;
+    int16_t outLeft = WIDTH;   // and the columns any of them cover
+    int16_t outRight = -1;
+
+    for (uint8_t bit = 0; bit < 8; bit++)
     {
-      swap(a,b);
+      int16_t y = page * 8 + bit;
+      int16_t left = spans.left[y] < 0 ? 0 : spans.left[y];
+      int16_t right = spans.right[y] >= WIDTH ? WIDTH - 1 : spans.right[y];
+
+      if (y < spans.top || y > spans.bottom || left > right)
+        continue;
+      rows |= 1 << bit;
+      toggles[left] ^= 1 << bit;
+      toggles[right + 1] ^= 1 << bit;
+      if (left > inLeft) inLeft = left;
+      if (right < inRight) inRight = right;
+      if (left < outLeft) outLeft = left;
+      if (right > outRight) outRight = right;
     }
+    if (!rows)
+      continue;
 
-    drawFastHLine(a, y, b-a+1, color);
+    uint8_t bits = 0;
+
+    for (int16_t x = outLeft; x <= outRight; x++)
+    {
+      bits ^= toggles[x];
+      toggles[x] = 0;
+      if (x == inLeft && inLeft <= inRight)
+      {
+        // no row starts or ends inside, so bits stays the same
+        fillPageSpan(pBuf + inLeft, inRight - inLeft + 1, rows, color);
+        x = inRight;
+      }
+      else
+      {
+        fillColumnByte(pBuf + x, bits, color);
+      }
+    }
+    toggles[outRight + 1] = 0;
   }
 }
 
@@ -639,43 +722,28 @@ void Arduboy2Base::drawBitmap
   if (x+w < 0 || x > WIDTH-1 || y+h < 0 || y > HEIGHT-1)
     return;
 
-  int yOffset = abs(y) % 8;
-  int sRow = y / 8;
-  if (y < 0) {
-    sRow--;
-    yOffset = 8 - yOffset;
-  }
+  int yOffset = y & 7;
+  int sRow = (y - yOffset) / 8; // rounded down
   int rows = h/8;
   if (h%8!=0) rows++;
-  for (int a = 0; a < rows; a++) {
-    int bRow = sRow + a;
-    if (bRow > (HEIGHT/8)-1) break;
-    if (bRow > -2) {
-      for (int iCol = 0; iCol<w; iCol++) {
-        if (iCol + x > (WIDTH-1)) break;
-        if (iCol + x >= 0) {
-          if (bRow >= 0) {
-            if (color == WHITE)
-              sBuffer[(bRow*WIDTH) + x + iCol] |= pgm_read_byte(bitmap+(a*w)+iCol) << yOffset;
-            else if (color == BLACK)
-              sBuffer[(bRow*WIDTH) + x + iCol] &= ~(pgm_read_byte(bitmap+(a*w)+iCol) << yOffset);
-            else
-              sBuffer[(bRow*WIDTH) + x + iCol] ^= pgm_read_byte(bitmap+(a*w)+iCol) << yOffset;
-          }
-          if (yOffset && bRow<(HEIGHT/8)-1 && bRow > -2) {
-            if (color == WHITE)
-              sBuffer[((bRow+1)*WIDTH) + x + iCol] |= pgm_read_byte(bitmap+(a*w)+iCol) >> (8-yOffset);
-            else if (color == BLACK)
-              sBuffer[((bRow+1)*WIDTH) + x + iCol] &= ~(pgm_read_byte(bitmap+(a*w)+iCol) >> (8-yOffset));
-            else
-              sBuffer[((bRow+1)*WIDTH) + x + iCol] ^= pgm_read_byte(bitmap+(a*w)+iCol) >> (8-yOffset);
-          }
-        }
-      }
-    }
-  }
-}
 
+  // the columns on the screen
+  int first = (x < 0) ? -x : 0;
+  int end = (x + w > WIDTH) ? WIDTH - x : w;
+
+  if (color == WHITE)
+    spritesBlit<SPRITES_BLIT_SET_IMAGE>
+      (sBuffer, sRow, x + first, yOffset, rows, bitmap + first, NULL, w,
+       end - first);
+  else if (color == BLACK)
+    spritesBlit<SPRITES_BLIT_CLEAR_IMAGE>
+      (sBuffer, sRow, x + first, yOffset, rows, bitmap + first, NULL, w,
+       end - first);
+  else
+    spritesBlit<SPRITES_BLIT_FLIP_IMAGE>
+      (sBuffer, sRow, x + first, yOffset, rows, bitmap + first, NULL, w,
+       end - first);
+}
 
 void Arduboy2Base::drawSlowXYBitmap
 (int16_t x, int16_t y, const uint8_t *bitmap, uint8_t w, uint8_t h, uint8_t color)
@@ -76,7 +76,8 @@
  * BLACK pixels will become WHITE and WHITE will become BLACK.
  *
  * \note
- * Only function Arduboy2Base::drawBitmap() currently supports this value.
+ * Only functions Arduboy2Base::drawBitmap(), drawFastHLine(), drawFastVLine(),
+ * fillRect(), fillTriangle() and fillPolygon() currently support this value.
  */
 #define INVERT 2
 
@@ -357,7 +358,12 @@ class Arduboy2Base : public Arduboy2Core
    * The contents of the display buffer in RAM are copied to the display and
    * will appear on the screen.
    *
-   * \see display(bool)
+   * When the library is built with `LINK_SPIM` this returns as soon as the
+   * frame has been queued, and the display buffer can be drawn in to while
+   * it is sent. Otherwise the CPU sends the frame itself, and this returns
+   * once it has reached the display.
+   *
+   * \see display(bool) displayBusy() waitDisplay()
    */
   void display();
 
@@ -547,6 +553,20 @@ class Arduboy2Base : public Arduboy2Core
    */
   void fillTriangle (int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t color = WHITE);
 
+  /** \brief
+   * Draw a filled-in convex polygon given the coordinates of its corners.
+   *
+   * \param points The corners, in order around the polygon, either way.
+   * \param count The number of corners.
+   * \param color The polygon's color (optional; defaults to WHITE).
+   *
+   * \details
+   * Each row is filled from the polygon's leftmost edge to its rightmost
+   * edge, so a polygon that isn't convex is drawn with its dents filled in
+   * from the left and right.
+   */
+  void fillPolygon(const Point points[], uint8_t count, uint8_t color = WHITE);
+
   /** \brief
    * Draw a bitmap from an array in program memory.
    *
@@ -1020,6 +1040,10 @@ class Arduboy2Base : public Arduboy2Core
   static void drawLogoSpritesBSelfMasked(int16_t y);
   static void drawLogoSpritesBOverwrite(int16_t y);
 
+  // set, clear or invert a clipped rectangle a page at a time, used by the
+  // line and fill functions
+  static void fillSpan(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t color);
+
   // For button handling
   uint8_t currentButtonState;
   uint8_t previousButtonState;
@@ -101,8 +101,29 @@ void Arduboy2Core::bootPins()
   pinMode(10, OUTPUT); // d0   (P0.27)
   pinMode(9,  OUTPUT); // d1   (P0.26)
 
-  pinMode(12, OUTPUT); // Spare! (P0.08 / FPGA pin 30)
-  NRF_P0->OUTCLR = 0x08;
+  pinMode(12, INPUT); // link error (P0.08 / FPGA pin 30)
+
+  // a single data clock aligns the FPGA's command framing
+  NRF_P0->OUTCLR = D0_BIT;
+  NRF_P0->OUTCLR = D1_BIT;
+  NRF_P0->OUTSET = DC_BIT;   // dc HIGH
+  NRF_P0->OUTCLR = WCLK_BIT; // wclk LOW
+  NRF_P0->OUTSET = WCLK_BIT; // wclk HIGH
+  NRF_P0->OUTCLR = DC_BIT;   // dc LOW
+
+#ifdef LINK_SPIM
+  // SPIM3 takes over wclk, d0 and dc
+  NRF_SPIM3->PSEL.SCK  = 28; // wclk (P0.28)
+  NRF_SPIM3->PSEL.MOSI = 26; // d0   (P0.26)
+  NRF_SPIM3->PSEL.MISO = 8;  // link error (P0.08), for the button events
+  NRF_SPIM3->PSELDCX   = 30; // dc   (P0.30)
+  NRF_SPIM3->FREQUENCY = LINK_SPIM_FREQUENCY;
+  NRF_SPIM3->CONFIG = 0; // MSB first, data sampled on the rising edge of wclk
+  NRF_SPIM3->RXD.MAXCNT = 0;
+  NRF_SPIM3->INTENSET = SPIM_INTENSET_END_Msk;
+  NVIC_EnableIRQ(SPIM3_IRQn);
+  NRF_SPIM3->ENABLE = SPIM_ENABLE_ENABLE_Enabled;
+#endif
 #elif defined(AB_DEVKIT)
 
 #endif
@@ -114,154 +135,912 @@ uint8_t Arduboy2Core::height() { return HEIGHT; }
 
 /* Drawing */
 
-void Arduboy2Core::paintScreen(uint8_t image[], bool clear)
+// FPGA link commands, sent while dc is LOW (see GBA.v)
+#define LINK_CMD_SOUND 0x00
+#define LINK_CMD_ADDR  0x01
+#define LINK_CMD_FLIP  0x02
+#define LINK_CMD_FILL  0x03
+#define LINK_CMD_MODE  0x04
+#define LINK_CMD_DELTA 0x05
+#define LINK_CMD_CHECK 0x06
+#define LINK_CMD_EVENTS 0x07
+#define LINK_CMD_PCM   0x08
+#define LINK_CMD_VOICE 0x10 // | PSG channel
+#define LINK_CMD_NOTE  0x14 // | PSG channel
+
+#define LINK_FILL_ON    0x0100 // CMD_FILL: set every pixel, otherwise clear
+#define LINK_FLIP_WHOLE 0x0004 // CMD_FLIP: every word of the bank was written
+#define LINK_MODE_INVERT 0x01  // CMD_MODE
+#define LINK_MODE_ALL_ON 0x02
+
+// After CMD_DELTA the data is a series of runs, each starting with a header
+// byte. 0nnnnnnn skips n + 1 words, leaving them as they were, and 1nnnnnnn
+// is followed by n + 1 words to write.
+#define DELTA_LITERAL 0x80
+#define DELTA_RUN_MAX 128
+
+// After CMD_EVENTS the FPGA sends the button events on link error, one bit for
+// each clock of data that follows (which is dropped): a two byte header
+// {count (4 bits), overflow, PCM FIFO level (5 bits), time (6 bits)} then count events
+// {0, 0, 0, 0, time (6 bits), buttons (6 bits, active LOW)}. The times count
+// the GBA's samples, about 1ms apart. After room for eight events come the
+// FPGA's counts of good, bad and lost frames, 16 bits each.
+#define LINK_EVENT_CLOCKS 192
+#define LINK_EVENT_BYTES (LINK_EVENT_CLOCKS / 8)
+#define LINK_EVENT_COUNTS 18 // byte offset of the frame counts
+
+// After CMD_PCM the data is PCM samples, sent in pairs, at most
+// LINK_PCM_MAX in each frame
+#define LINK_PCM_MAX 512
+#define PCM_FIFO 1024 // in the FPGA
+#define PCM_LEVEL_UNIT 32
+
+// CMD_VOICE and CMD_NOTE set one of the GBA's PSG channels, square 1, square
+// 2, wave and noise, to the values of its SOUNDxCNT_H and _X registers.
+// Each CMD_NOTE starts the channel again with them.
+#define PSG_CHANNELS 4
+#define PSG_WAVE 2
+#define PSG_NOISE 3
+#define PSG_RESET 0x8000
+#define PSG_DUTY_HALF 0x0080
+
+#define VRAM_ROW_WORDS 8 // 16 pixels per word, two per symbol
+#define VRAM_WORDS 512   // in each bank
+#define VRAM_BANKS 3
+
+#define VRAM_NO_BANK 0xFF
+
+// Each frame is written in to a bank the GBA isn't showing and then flipped
+// to, so the GBA never displays a partly written frame. The image as it was
+// last sent to each bank is kept, so only changes need to be sent.
+static uint8_t sentImage[VRAM_BANKS][(WIDTH * HEIGHT) / 8];
+static bool sentImageValid[VRAM_BANKS];
+
+static uint8_t linkBank = 0;  // bank the next frame is written in to
+static uint8_t linkFlipBank = VRAM_NO_BANK; // flipped to by the last frame, not yet known to be shown
+static volatile uint8_t linkShown[2] = { 0, 0 }; // the last two banks the FPGA took, latest first
+static uint8_t displayMode = 0; // CMD_MODE bits
+
+// Every frame ends with a check of the bytes sent since the last one and a
+// frame number, so the FPGA can refuse a bad frame and count them. It then
+// holds link error HIGH, refusing frames of changes, until a frame that
+// writes a whole bank is good, so the pin after a flip says whether it was
+// taken. The pin also carries the button events after CMD_EVENTS, so it is only
+// read once a frame has ended with its flip: by linkBegin() before the next
+// one, or by the SPIM interrupt as the last transfer ends.
+static uint8_t linkCheckA = 0; // Fletcher style sums of the bytes sent
+static uint8_t linkCheckB = 0;
+static uint8_t linkFrameNumber = 0;
+static uint16_t linkErrorCount = 0;
+static DisplayCounts linkCounts = { 0, 0, 0 }; // the FPGA's, from the events
+static volatile bool linkErrorSeen = false; // link error HIGH after a frame
+
+static inline void linkCheck(const uint8_t *data, uint8_t length)
 {
-  uint8_t upperByteTemp = upperByte;
-  uint8_t lowerByteTemp = lowerByte;
+  for (uint8_t i = 0; i < length; i++)
+  {
+    linkCheckA += data[i];
+    linkCheckB += linkCheckA;
+  }
+}
 
-  NRF_P0->OUTSET = DC_BIT; // dc HIGH
+// A flip and its check have gone out, and link error after them says whether
+// the FPGA refused the flip (see GBA.v). The GBA shows bank 0 from reset.
+static void linkFlipped(uint8_t bank, bool refused)
+{
+  if (refused)
+  {
+    linkErrorSeen = true;
+  }
+  else if (bank != linkShown[0])
+  {
+    linkShown[1] = linkShown[0];
+    linkShown[0] = bank;
+  }
+}
 
-  for (uint8_t t = 0; t < 8; t++) // eight 'pages'
+// The bank for the next frame: not the one shown, nor one a frame still going
+// out may flip to. With only the shown bank to avoid, the one shown before
+// it is avoided too, so the banks are used in turn and a bank whose frame
+// was refused is the next written.
+static uint8_t linkChooseBank(uint8_t inFlight)
+{
+  uint8_t avoid = 1 << linkShown[0];
+  uint8_t bank = 0;
+
+  if (inFlight != VRAM_NO_BANK) avoid |= 1 << inFlight;
+  if (!(avoid & (avoid - 1))) avoid |= 1 << linkShown[1];
+
+  while (avoid & (1 << bank)) bank++;
+  return bank;
+}
+
+// Button events read back from the FPGA, kept in a ring until buttonsState()
+// takes them
+static ButtonEvent buttonEvents[BUTTON_EVENTS];
+static uint8_t buttonEventFirst = 0;
+static uint8_t buttonEventCount = 0;
+static uint16_t buttonEventLosses = 0; // FPGA overflows and events dropped here
+
+// PCM samples waiting to be sent, and the level of the FPGA's FIFO as last
+// reported plus the samples sent after the report
+static int8_t pcmBuffer[PCM_BUFFER];
+static uint16_t pcmFirst = 0;
+static uint16_t pcmCount = 0;
+static volatile uint16_t pcmLevel = 0;
+
+// The score being played, read from flash as it is due, and the PSG channel
+// values not yet sent
+static const uint8_t *scoreStart = NULL;
+static const uint8_t *scoreNext = NULL; // NULL when stopped
+static unsigned long scoreDue;          // millis() of the next command
+static bool scoreVolumes;               // a volume follows each note
+static uint16_t psgVoice[PSG_CHANNELS];
+static uint16_t psgNote[PSG_CHANNELS];
+static uint8_t psgChanged = 0;          // a bit for each channel
+
+// add the events in the stream sent after CMD_EVENTS
+static void linkEventsReceived(const uint8_t *stream)
+{
+  uint8_t count = stream[0] >> 4;
+  uint8_t now = stream[1] & 0x3F;
+  unsigned long time = millis();
+
+  if (stream[0] & 0x08) buttonEventLosses++; // more than 8 since the last frame
+
+  pcmLevel = (((stream[0] & 0x07) << 2) | (stream[1] >> 6)) * PCM_LEVEL_UNIT;
+
+  linkCounts.good = (stream[LINK_EVENT_COUNTS] << 8) | stream[LINK_EVENT_COUNTS + 1];
+  linkCounts.bad  = (stream[LINK_EVENT_COUNTS + 2] << 8) | stream[LINK_EVENT_COUNTS + 3];
+  linkCounts.lost = (stream[LINK_EVENT_COUNTS + 4] << 8) | stream[LINK_EVENT_COUNTS + 5];
+
+  for (uint8_t i = 0; i < count && i < BUTTON_EVENTS; i++)
   {
-    for (uint8_t r = 0; r < 8; r++) // eight bits
+    const uint8_t *event = &stream[2 + i * 2];
+    uint8_t age = (now - (((event[0] & 0x0F) << 2) | (event[1] >> 6))) & 0x3F;
+    ButtonEvent &added = buttonEvents[(buttonEventFirst + buttonEventCount) % BUTTON_EVENTS];
+
+    added.buttons = (~event[1] & 0x3F) << 2;
+    added.time = time - age;
+
+    if (buttonEventCount < BUTTON_EVENTS)
+      buttonEventCount++;
+    else
     {
-      uint16_t a = t * 128; // starting address
+      buttonEventFirst = (buttonEventFirst + 1) % BUTTON_EVENTS; // oldest dropped
+      buttonEventLosses++;
+    }
+  }
+}
 
-      uint8_t bitMask = B00000001 << r;
+// Transpose eight column bytes (bit 0 at the top) in to eight row bytes
+// (leftmost pixel in bit 7), using 32 bit operations on two halves of the
+// 8x8 bit matrix. (Hacker's Delight, 7-3)
+static void transpose8(const uint8_t *column, uint8_t *row, uint8_t rowStride)
+{
+  uint32_t x, y, t;
+
+  x = (column[0] << 24) | (column[1] << 16) | (column[2] << 8) | column[3];
+  y = (column[4] << 24) | (column[5] << 16) | (column[6] << 8) | column[7];
+
+  t = (x ^ (x >> 7)) & 0x00AA00AA;  x = x ^ t ^ (t << 7);
+  t = (y ^ (y >> 7)) & 0x00AA00AA;  y = y ^ t ^ (t << 7);
+
+  t = (x ^ (x >> 14)) & 0x0000CCCC;  x = x ^ t ^ (t << 14);
+  t = (y ^ (y >> 14)) & 0x0000CCCC;  y = y ^ t ^ (t << 14);
+
+  t = (x & 0xF0F0F0F0) | ((y >> 4) & 0x0F0F0F0F);
+  y = ((x << 4) & 0xF0F0F0F0) | (y & 0x0F0F0F0F);
+  x = t;
+
+  // the bottom pixel row comes out first
+  row[7 * rowStride] = x >> 24;
+  row[6 * rowStride] = x >> 16;
+  row[5 * rowStride] = x >> 8;
+  row[4 * rowStride] = x;
+  row[3 * rowStride] = y >> 24;
+  row[2 * rowStride] = y >> 16;
+  row[1 * rowStride] = y >> 8;
+  row[0]             = y;
+}
 
-      for (uint8_t i = 0; i < 16; i++) // 16 horizontal bytes = 128 pixels
-      {
-        if (image[a] & bitMask) NRF_P0->OUTSET = D0_BIT;
-        else                    NRF_P0->OUTCLR = D0_BIT;
+// convert the given columns of a page in to eight packed scanlines, one
+// after another, WIDTH / 8 bytes each
+static void transposePage(const uint8_t *page, uint8_t first, uint8_t end,
+                          uint8_t *scanlines)
+{
+  for (uint8_t x = first; x < end; x += 8)
+  {
+    transpose8(&page[x], &scanlines[x / 8], WIDTH / 8);
+  }
+}
 
-        a++;
+// Each backend provides:
+//   linkBegin()   prepare for a new frame
+//   linkNextBank() choose linkBank for it
+//   linkCommand() send a command
+//   linkData()    send bytes of pixel data or delta run headers
+//   linkEvents()  send CMD_EVENTS and read back the button events and counts
+//   linkPcm()     note the number of PCM samples sent after linkEvents()
+//   linkEnd()     finish the frame
+
+#ifdef LINK_SPIM
+
+// The frame is built in RAM as a list of EasyDMA transfers, each sending its
+// command bytes with dc (SPIM3 DCX) LOW followed by its data with dc HIGH.
+// The END interrupt starts the next transfer, so the sketch keeps running
+// while the frame is clocked out.
+//
+// There are two frame buffers. While one is being sent the next frame is
+// built in the other and queued behind it, so paintScreen() only has to
+// wait when a third frame is ready before the first has gone out.
+
+#define LINK_COMMAND_BYTES 3
+
+// nRF52840 anomaly 198: SPIM3 can send corrupt data when the CPU uses the
+// same RAM block as its TXD buffer, as it does building the next frame beside
+// the one going out. The workaround nrfx uses gives SPIM3 priority in the RAM
+// blocks the buffer is in, through an undocumented register, for as long as
+// the transfers go on.
+#ifndef NRF_ANOMALY_198
+#define NRF_ANOMALY_198 (*(volatile uint32_t *) 0x40000E00)
+#endif
+#define RAM_BLOCK_START 0x20000000
+#define RAM_BLOCK_SIZE  0x2000 // RAM0 - RAM7, then RAM8 above them
+#define RAM_BLOCKS_SMALL 8
 
-        if (image[a] & bitMask) NRF_P0->OUTSET = D1_BIT;
-        else                    NRF_P0->OUTCLR = D1_BIT;
+static void linkAnomaly198(const uint8_t *buffer, uint16_t length)
+{
+  uint32_t start = (uintptr_t) buffer - RAM_BLOCK_START;
+  uint32_t end = start + length - 1;
+  uint32_t blocks = 0;
 
-        a++;
+  for (uint32_t block = start / RAM_BLOCK_SIZE; block <= end / RAM_BLOCK_SIZE; block++)
+  {
+    if (block >= RAM_BLOCKS_SMALL)
+    {
+      blocks |= 1UL << RAM_BLOCKS_SMALL;
+      break;
+    }
+    blocks |= 1UL << block;
+  }
+  NRF_ANOMALY_198 = blocks;
+}
 
-        NRF_P0->OUTCLR = WCLK_BIT; // wclk LOW
-        NRF_P0->OUTSET = WCLK_BIT; // wclk HIGH
+struct LinkTransfer
+{
+  uint16_t offset;      // start within the frame's buffer
+  uint16_t length;      // command and data bytes
+  uint8_t commandBytes; // sent with dc LOW
+};
 
-        if (image[a] & bitMask) NRF_P0->OUTSET = D0_BIT;
-        else                    NRF_P0->OUTCLR = D0_BIT;
+struct LinkFrame
+{
+  // the events command and its clocks, every word of the image, a run
+  // header for at most every word, and the delta, PSG, sound, check and
+  // flip commands
+  uint8_t buffer[LINK_EVENT_BYTES + LINK_PCM_MAX + (VRAM_WORDS * 3) +
+                 ((6 + PSG_CHANNELS * 2) * LINK_COMMAND_BYTES)];
+  LinkTransfer transfers[6]; // the events, PCM, the delta, then PSG, sound, check and flip
+  uint16_t length;
+  uint8_t count;
+  uint16_t pcmSamples; // sent after the events
+  uint8_t bank;         // flipped to, or VRAM_NO_BANK
+  uint8_t eventsTransfer; // the transfer reading the events, if < count
+  uint8_t events[LINK_COMMAND_BYTES + LINK_EVENT_BYTES]; // received during it
+};
+
+static LinkFrame linkFrames[2];
+static LinkFrame *linkFrame = &linkFrames[0]; // the frame being built
+static LinkFrame * volatile linkSending = NULL;
+static LinkFrame * volatile linkQueued = NULL;
+static volatile uint8_t linkNext;
+
+static void linkStart(LinkFrame *frame, uint8_t i)
+{
+  const LinkTransfer &transfer = frame->transfers[i];
+
+  linkAnomaly198(&frame->buffer[transfer.offset], transfer.length);
+  NRF_SPIM3->TXD.PTR = (uintptr_t) &frame->buffer[transfer.offset];
+  NRF_SPIM3->TXD.MAXCNT = transfer.length;
+  NRF_SPIM3->RXD.PTR = (uintptr_t) frame->events;
+  NRF_SPIM3->RXD.MAXCNT = (i == frame->eventsTransfer) ? transfer.length : 0;
+  NRF_SPIM3->DCXCNT = transfer.commandBytes;
+  NRF_SPIM3->TASKS_START = 1;
+}
 
-        a++;
+extern "C" void SPIM3_IRQHandler(void)
+{
+  NRF_SPIM3->EVENTS_END = 0;
 
-        if (image[a] & bitMask) NRF_P0->OUTSET = D1_BIT;
-        else                    NRF_P0->OUTCLR = D1_BIT;
+  if (linkNext - 1 == linkSending->eventsTransfer)
+  {
+    linkEventsReceived(&linkSending->events[LINK_COMMAND_BYTES]);
+    pcmLevel += linkSending->pcmSamples;
+  }
 
-        a++;
+  if (linkNext < linkSending->count)
+  {
+    linkStart(linkSending, linkNext++);
+    return;
+  }
 
-        NRF_P0->OUTCLR = WCLK_BIT; // wclk LOW
-        NRF_P0->OUTSET = WCLK_BIT; // wclk HIGH
+  if (linkSending->bank != VRAM_NO_BANK)
+    linkFlipped(linkSending->bank, NRF_P0->IN & LINK_ERROR_BIT);
 
-        if (image[a] & bitMask) NRF_P0->OUTSET = D0_BIT;
-        else                    NRF_P0->OUTCLR = D0_BIT;
+  if (linkQueued)
+  {
+    linkSending = linkQueued;
+    linkQueued = NULL;
+    linkNext = 1;
+    linkStart(linkSending, 0);
+  }
+  else
+  {
+    linkSending = NULL;
+    NRF_ANOMALY_198 = 0; // its reset value, nothing else here uses it
+  }
+}
 
-        a++;
+static void linkBegin()
+{
+  while (linkSending == linkFrame) { } // still going out, two frames ago
+  linkFrame->length = 0;
+  linkFrame->count = 0;
+  linkFrame->eventsTransfer = 0xFF;
+  linkFrame->pcmSamples = 0;
+}
 
-        if (image[a] & bitMask) NRF_P0->OUTSET = D1_BIT;
-        else                    NRF_P0->OUTCLR = D1_BIT;
+// the frame in the other buffer may still be going out
+static void linkNextBank()
+{
+  LinkFrame *other = (linkFrame == &linkFrames[0]) ? &linkFrames[1] : &linkFrames[0];
 
-        a++;
+  NVIC_DisableIRQ(SPIM3_IRQn); // linkShown changes as a frame ends
+  bool going = (other == linkSending || other == linkQueued);
+  linkBank = linkChooseBank(going ? other->bank : VRAM_NO_BANK);
+  NVIC_EnableIRQ(SPIM3_IRQn);
+}
 
-        NRF_P0->OUTCLR = WCLK_BIT; // wclk LOW
-        NRF_P0->OUTSET = WCLK_BIT; // wclk HIGH
+static void linkCommand(uint8_t command, uint16_t arg)
+{
+  LinkFrame *frame = linkFrame;
+  LinkTransfer *transfer = frame->count ? &frame->transfers[frame->count - 1] : NULL;
 
-        if (image[a] & bitMask) NRF_P0->OUTSET = D0_BIT;
-        else                    NRF_P0->OUTCLR = D0_BIT;
+  // commands following one another share a transfer, up to the most DCXCNT
+  // can send with dc LOW
+  if (!transfer || transfer->length != transfer->commandBytes ||
+      transfer->commandBytes + LINK_COMMAND_BYTES > 15)
+  {
+    transfer = &frame->transfers[frame->count++];
+    transfer->offset = frame->length;
+    transfer->length = 0;
+    transfer->commandBytes = 0;
+  }
 
-        a++;
+  transfer->length += LINK_COMMAND_BYTES;
+  transfer->commandBytes += LINK_COMMAND_BYTES;
 
-        if (image[a] & bitMask) NRF_P0->OUTSET = D1_BIT;
-        else                    NRF_P0->OUTCLR = D1_BIT;
+  frame->buffer[frame->length++] = command;
+  frame->buffer[frame->length++] = arg >> 8;
+  frame->buffer[frame->length++] = arg;
 
-        a++;
+  linkCheck(&frame->buffer[frame->length - LINK_COMMAND_BYTES], LINK_COMMAND_BYTES);
+}
 
-        NRF_P0->OUTCLR = WCLK_BIT; // wclk LOW
-        NRF_P0->OUTSET = WCLK_BIT; // wclk HIGH
-      }
+// the data is added to the transfer of the last command
+static void linkData(const uint8_t *data, uint8_t length)
+{
+  LinkFrame *frame = linkFrame;
 
-      NRF_P0->OUTCLR = D0_BIT;
-      NRF_P0->OUTCLR = D1_BIT;
+  linkCheck(data, length);
 
-      for (uint8_t i = 0; i < 56; i++) // 128 + 112 = 240 horizontal pixels
-      {
-        NRF_P0->OUTCLR = WCLK_BIT; // wclk LOW
-        NRF_P0->OUTSET = WCLK_BIT; // wclk HIGH
-      }
+  memcpy(&frame->buffer[frame->length], data, length);
+  frame->length += length;
+  frame->transfers[frame->count - 1].length += length;
+}
+
+// the events are received while the frame is sent, as its transfer ends
+static void linkEvents()
+{
+  static const uint8_t clocks[LINK_EVENT_BYTES] = { 0 };
+
+  linkCommand(LINK_CMD_EVENTS, 0);
+  linkFrame->eventsTransfer = linkFrame->count - 1;
+  linkData(clocks, LINK_EVENT_BYTES);
+}
+
+// added to the level when the events arrive
+static void linkPcm(uint16_t samples)
+{
+  linkFrame->pcmSamples = samples;
+}
+
+static void linkEnd()
+{
+  linkFrame->bank = linkFlipBank;
+  linkFlipBank = VRAM_NO_BANK;
+
+  NVIC_DisableIRQ(SPIM3_IRQn);
+  if (linkSending)
+  {
+    linkQueued = linkFrame; // started when the current frame ends
+  }
+  else
+  {
+    linkSending = linkFrame;
+    linkNext = 1;
+    linkStart(linkFrame, 0);
+  }
+  NVIC_EnableIRQ(SPIM3_IRQn);
+
+  linkFrame = (linkFrame == &linkFrames[0]) ? &linkFrames[1] : &linkFrames[0];
+}
+
+bool Arduboy2Core::displayBusy()
+{
+  return linkSending != NULL;
+}
+
+void Arduboy2Core::waitDisplay()
+{
+  while (linkSending) { }
+}
+
+#else
+
+// Each clock is two stores to the port's OUT register: the data with wclk
+// LOW, then the same with wclk HIGH. The other P0 outputs are read when a
+// burst of clocks starts and written back unchanged, so interrupts are masked
+// for the burst, one command or up to 255 data bytes, and none can change
+// them in between.
+
+// OUT register bits for each two bit symbol, D0 carrying the more
+// significant bit
+static const uint32_t symbolBits[4] = { 0, D1_BIT, D0_BIT, D0_BIT | D1_BIT };
+
+static uint32_t linkPort; // P0 OUT with wclk, d0 and d1 cleared
+static uint32_t linkPrimask; // as it was before linkLock()
+
+static inline void linkLock(uint32_t dc)
+{
+  linkPrimask = __get_PRIMASK();
+  __disable_irq();
+  linkPort = (NRF_P0->OUT & ~(WCLK_BIT | D0_BIT | D1_BIT | DC_BIT)) | dc;
+}
+
+static inline void linkUnlock()
+{
+  __set_PRIMASK(linkPrimask);
+}
+
+static inline void writeByte(uint8_t data)
+{
+  uint32_t out;
+
+  out = linkPort | symbolBits[data >> 6];
+  NRF_P0->OUT = out;            // wclk LOW
+  NRF_P0->OUT = out | WCLK_BIT; // wclk HIGH
+  out = linkPort | symbolBits[(data >> 4) & B00000011];
+  NRF_P0->OUT = out;
+  NRF_P0->OUT = out | WCLK_BIT;
+  out = linkPort | symbolBits[(data >> 2) & B00000011];
+  NRF_P0->OUT = out;
+  NRF_P0->OUT = out | WCLK_BIT;
+  out = linkPort | symbolBits[data & B00000011];
+  NRF_P0->OUT = out;
+  NRF_P0->OUT = out | WCLK_BIT;
+}
+
+// the last frame's flip has gone out by now
+static void linkBegin()
+{
+  if (linkFlipBank != VRAM_NO_BANK)
+  {
+    linkFlipped(linkFlipBank, NRF_P0->IN & LINK_ERROR_BIT);
+    linkFlipBank = VRAM_NO_BANK;
+  }
+}
+
+static void linkNextBank()
+{
+  linkBank = linkChooseBank(VRAM_NO_BANK);
+}
+
+static void linkCommand(uint8_t command, uint16_t arg)
+{
+  uint8_t bytes[3] = { command, (uint8_t) (arg >> 8), (uint8_t) arg };
+
+  linkCheck(bytes, 3);
+  linkLock(0); // dc LOW
+
+  writeByte(bytes[0]);
+  writeByte(bytes[1]);
+  writeByte(bytes[2]);
+  linkUnlock();
+}
+
+static void linkData(const uint8_t *data, uint8_t length)
+{
+  linkCheck(data, length);
+  linkLock(DC_BIT); // dc HIGH
+
+  for (uint8_t i = 0; i < length; i++) // four clocks per byte
+  {
+    writeByte(data[i]);
+  }
+  linkUnlock();
+}
+
+// Each clock sends a zero symbol, which the FPGA drops, and link error is read
+// while wclk is HIGH, after the FPGA changed it as wclk fell.
+static void linkEvents()
+{
+  uint8_t zeros[LINK_EVENT_CLOCKS / 4] = { 0 }; // four clocks per byte
+  uint8_t stream[LINK_EVENT_BYTES];
+
+  linkCommand(LINK_CMD_EVENTS, 0);
+  linkCheck(zeros, sizeof(zeros));
+  linkLock(DC_BIT); // dc HIGH
+
+  for (uint8_t i = 0; i < LINK_EVENT_BYTES; i++)
+  {
+    uint8_t bits = 0;
+
+    for (uint8_t b = 0; b < 8; b++)
+    {
+      NRF_P0->OUT = linkPort;            // wclk LOW
+      NRF_P0->OUT = linkPort | WCLK_BIT; // wclk HIGH
+      bits = (bits << 1) | ((NRF_P0->IN & LINK_ERROR_BIT) ? 1 : 0);
     }
+    stream[i] = bits;
   }
+  linkUnlock();
+
+  linkEventsReceived(stream);
+}
+
+static void linkPcm(uint16_t samples)
+{
+  pcmLevel += samples;
+}
+
+// the frame has been sent, ending with a command that leaves dc LOW
+static void linkEnd() { }
+
+bool Arduboy2Core::displayBusy()
+{
+  return false;
+}
 
-  NRF_P0->OUTCLR = DC_BIT; // dc LOW
+void Arduboy2Core::waitDisplay() { }
 
-  for (uint8_t i = 0; i < 4; i++)
+#endif
+
+// flip to linkBank and check the frame, the flip included
+static void linkFlip(bool whole)
+{
+  // the check is added in too, but the sums start again after
+  linkCommand(LINK_CMD_FLIP, (linkFrameNumber << 8) |
+                             (whole ? LINK_FLIP_WHOLE : 0) | linkBank);
+  linkCommand(LINK_CMD_CHECK, (linkCheckB << 8) | linkCheckA);
+  linkCheckA = 0;
+  linkCheckB = 0;
+  linkFrameNumber++;
+  linkFlipBank = linkBank;
+}
+
+// have the FPGA fill all of linkBank, then flip to it
+static void linkFill(bool on)
+{
+  linkBegin();
+  linkNextBank();
+  linkCommand(LINK_CMD_FILL, (on ? LINK_FILL_ON : 0) | linkBank);
+  linkFlip(true);
+  linkEnd();
+}
+
+static void linkMode(uint8_t mode)
+{
+  linkBegin();
+  linkCommand(LINK_CMD_MODE, mode);
+  linkEnd();
+}
+
+// send the queued PCM samples, in pairs
+static void pcmSend()
+{
+  uint16_t count = pcmCount & ~1;
+
+  if (count > LINK_PCM_MAX) count = LINK_PCM_MAX;
+  if (count == 0) return;
+
+  linkCommand(LINK_CMD_PCM, 0);
+  for (uint16_t sent = 0; sent < count; )
   {
-    if (upperByteTemp & B10000000) NRF_P0->OUTSET = D0_BIT;
-    else                           NRF_P0->OUTCLR = D0_BIT;
-    if (upperByteTemp & B01000000) NRF_P0->OUTSET = D1_BIT;
-    else                           NRF_P0->OUTCLR = D1_BIT;
+    // up to the end of the ring, in pieces linkData() can take
+    uint16_t length = PCM_BUFFER - pcmFirst;
 
-    NRF_P0->OUTCLR = WCLK_BIT; // wclk LOW
-    NRF_P0->OUTSET = WCLK_BIT; // wclk HIGH
+    if (length > count - sent) length = count - sent;
+    if (length > 128) length = 128;
 
-    upperByteTemp = upperByteTemp << 2;
+    linkData((const uint8_t *) &pcmBuffer[pcmFirst], length);
+    pcmFirst = (pcmFirst + length) % PCM_BUFFER;
+    sent += length;
   }
-  for (uint8_t i = 0; i < 4; i++)
+  pcmCount -= count;
+  linkPcm(count);
+}
+
+// Periods of the GBA's square channels, 2048 - frequency value, times 16 for
+// notes 36 (C2) to 47. Higher octaves halve them.
+static const uint16_t psgPeriods[12] =
+{
+  32063, 30264, 28565, 26962, 25449, 24020, 22672, 21400, 20199, 19065, 17995, 16985
+};
+
+static void psgNoteOn(uint8_t channel, uint8_t note, uint8_t volume)
+{
+  uint16_t voice = (volume >> 3) << 12; // initial envelope volume, no steps
+
+  if (channel == PSG_NOISE)
   {
-    if (lowerByteTemp & B10000000) NRF_P0->OUTSET = D0_BIT;
-    else                           NRF_P0->OUTCLR = D0_BIT;
-    if (lowerByteTemp & B01000000) NRF_P0->OUTSET = D1_BIT;
-    else                           NRF_P0->OUTCLR = D1_BIT;
+    // higher notes shift the noise faster, with a dividing ratio of 1
+    int8_t shift = (96 - (int16_t) note) / 6;
 
-    NRF_P0->OUTCLR = WCLK_BIT; // wclk LOW
-    NRF_P0->OUTSET = WCLK_BIT; // wclk HIGH
+    if (shift < 0) shift = 0;
+    if (shift > 13) shift = 13;
+    psgNote[channel] = PSG_RESET | (shift << 4) | 1;
+  }
+  else
+  {
+    while (note < 36) note += 12; // the lowest the channels can play
+    uint8_t octave = (note - 36) / 12;
+    uint16_t period = (psgPeriods[(note - 36) % 12] + (8 << octave)) >> (4 + octave);
 
-    lowerByteTemp = lowerByteTemp << 2;
+    if (channel == PSG_WAVE) period = (period + 1) / 2; // 32 samples, not 8
+    psgNote[channel] = PSG_RESET | (2048 - period);
+    voice |= PSG_DUTY_HALF;
   }
+
+  psgVoice[channel] = voice;
+  psgChanged |= 1 << channel;
 }
 
-void Arduboy2Core::blank()
+static void psgNoteOff(uint8_t channel)
 {
-  NRF_P0->OUTCLR = D0_BIT;
-  NRF_P0->OUTCLR = D1_BIT;
+  psgVoice[channel] = 0; // started again at no volume
+  psgChanged |= 1 << channel;
+}
 
-  NRF_P0->OUTSET = DC_BIT; // dc HIGH
+// Play the commands of the score that are due: 0x9t note [volume] starts a
+// note on track t, 0x8t stops it, 0xCt instrument is skipped, 0xE0 starts
+// the score again, 0xF0 ends it, and anything below 0x80 starts a big endian
+// wait in ms.
+static void scoreStep()
+{
+  unsigned long now = millis();
 
-  for (uint16_t i = 0; i < 19200; i++)
+  while (scoreNext && (long) (now - scoreDue) >= 0)
   {
-    NRF_P0->OUTCLR = WCLK_BIT; // wclk LOW
-    NRF_P0->OUTSET = WCLK_BIT; // wclk HIGH
+    uint8_t command = pgm_read_byte(scoreNext++);
+    uint8_t channel = command & 0x0F;
+
+    if (command < 0x80)
+    {
+      scoreDue += (command << 8) | pgm_read_byte(scoreNext++);
+      continue;
+    }
+
+    switch (command & 0xF0)
+    {
+      case 0x90:
+      {
+        uint8_t note = pgm_read_byte(scoreNext++);
+        uint8_t volume = scoreVolumes ? pgm_read_byte(scoreNext++) : 127;
+
+        if (channel < PSG_CHANNELS) psgNoteOn(channel, note, volume);
+        break;
+      }
+      case 0x80:
+        if (channel < PSG_CHANNELS) psgNoteOff(channel);
+        break;
+      case 0xC0:
+        scoreNext++;
+        break;
+      case 0xE0:
+        scoreNext = scoreStart;
+        break;
+      default: // 0xF0, the end
+        Arduboy2Core::stopScore();
+        break;
+    }
   }
+}
 
-  NRF_P0->OUTCLR = DC_BIT;   // dc LOW
-  NRF_P0->OUTCLR = WCLK_BIT; // wclk LOW
-  NRF_P0->OUTSET = WCLK_BIT; // wclk HIGH
+// send the PSG channels that changed
+static void psgSend()
+{
+  for (uint8_t channel = 0; channel < PSG_CHANNELS; channel++)
+  {
+    if (!(psgChanged & (1 << channel))) continue;
+
+    linkCommand(LINK_CMD_VOICE | channel, psgVoice[channel]);
+    linkCommand(LINK_CMD_NOTE | channel, psgNote[channel]);
+  }
+  psgChanged = 0;
 }
 
-// turn all display pixels on, ignoring buffer contents
-// or set to normal buffer display
-void Arduboy2Core::allPixelsOn(bool on)
+// send the header bytes for skipping the given number of words
+static void deltaSkip(uint16_t skip)
 {
-  if (on)
+  while (skip > 0)
   {
-    NRF_P0->OUTSET = D0_BIT;
-    NRF_P0->OUTSET = D1_BIT;
+    uint8_t run = (skip > DELTA_RUN_MAX) ? DELTA_RUN_MAX : skip;
+    uint8_t header = run - 1;
 
-    NRF_P0->OUTSET = DC_BIT; // dc HIGH
+    linkData(&header, 1);
+    skip -= run;
+  }
+}
 
-    for (uint16_t i = 0; i < 19200; i++)
+void Arduboy2Core::paintScreen(uint8_t image[], bool clear)
+{
+  uint8_t scanlines[8 * (WIDTH / 8)];
+  uint8_t *sent;
+  bool full;
+  bool started = false; // CMD_DELTA sent
+  uint16_t skip = 0;    // unchanged words not yet skipped
+
+  linkBegin();
+  linkNextBank();
+  if (linkErrorSeen)
+  {
+    // a frame was refused, so none of the FPGA's copies can be trusted,
+    // the refused bank's least of all
+    linkErrorSeen = false;
+    memset(sentImageValid, 0, sizeof(sentImageValid));
+    linkErrorCount++;
+  }
+  sent = sentImage[linkBank];
+  full = !sentImageValid[linkBank];
+
+  linkEvents();
+  pcmSend();
+
+  for (uint8_t t = 0; t < 8; t++) // eight 'pages'
+  {
+    uint16_t a = t * 128; // starting address
+    uint8_t changed[VRAM_ROW_WORDS]; // rows of each word of the page that changed
+    uint8_t first = WIDTH;
+    uint8_t end = 0;
+
+    // XOR with the image last sent to this bank, one bit for each row
+    for (uint8_t w = 0; w < VRAM_ROW_WORDS; w++)
     {
-      NRF_P0->OUTCLR = WCLK_BIT; // wclk LOW
-      NRF_P0->OUTSET = WCLK_BIT; // wclk HIGH
+      uint8_t diff = 0;
+
+      for (uint8_t x = w * 16; x < (w + 1) * 16; x++)
+      {
+        diff |= image[a + x] ^ sent[a + x];
+      }
+      changed[w] = full ? 0xFF : diff;
+
+      if (changed[w])
+      {
+        if (first == WIDTH) first = w * 16;
+        end = (w + 1) * 16;
+      }
+    }
+
+    if (first >= end) // page unchanged
+    {
+      skip += 8 * VRAM_ROW_WORDS;
+      continue;
+    }
+
+    transposePage(&image[a], first, end, scanlines);
+
+    // the page's words in VRAM order, eight rows of eight
+    uint8_t i = 0;
+    while (i < 8 * VRAM_ROW_WORDS)
+    {
+      uint8_t bit = 1 << (i / VRAM_ROW_WORDS);
+
+      if (!(changed[i % VRAM_ROW_WORDS] & bit))
+      {
+        skip++;
+        i++;
+        continue;
+      }
+
+      uint8_t run = 1;
+      while (i + run < 8 * VRAM_ROW_WORDS &&
+             (changed[(i + run) % VRAM_ROW_WORDS] & (1 << ((i + run) / VRAM_ROW_WORDS))))
+      {
+        run++;
+      }
+
+      if (!started)
+      {
+        // the first skip is made by the start address
+        linkCommand(LINK_CMD_DELTA, linkBank * VRAM_WORDS + skip);
+        started = true;
+      }
+      else
+      {
+        deltaSkip(skip);
+      }
+      skip = 0;
+
+      // the scanlines are contiguous, so the run's words are too
+      uint8_t header = DELTA_LITERAL | (run - 1);
+      linkData(&header, 1);
+      linkData(&scanlines[i * 2], run * 2);
+
+      i += run;
     }
 
-    NRF_P0->OUTCLR = DC_BIT;   // dc LOW
-    NRF_P0->OUTCLR = WCLK_BIT; // wclk LOW
-    NRF_P0->OUTSET = WCLK_BIT; // wclk HIGH
+    memcpy(&sent[a + first], &image[a + first], end - first);
   }
+
+  sentImageValid[linkBank] = true;
+
+  scoreStep();
+  psgSend();
+  linkCommand(LINK_CMD_SOUND, (upperByte << 8) | lowerByte);
+  linkFlip(full);
+  linkEnd();
+
+  if (clear) memset(image, 0, (WIDTH * HEIGHT) / 8);
+}
+
+void Arduboy2Core::blank()
+{
+  linkFill(false);
+
+  memset(sentImage[linkBank], 0, sizeof(sentImage[linkBank]));
+  sentImageValid[linkBank] = true;
+}
+
+// invert the display or set to normal
+void Arduboy2Core::invert(bool inverse)
+{
+  if (inverse) displayMode |= LINK_MODE_INVERT;
+  else displayMode &= ~LINK_MODE_INVERT;
+
+  linkMode(displayMode);
+}
+
+// turn all display pixels on, ignoring buffer contents
+// or set to normal buffer display
+void Arduboy2Core::allPixelsOn(bool on)
+{
+  if (on) displayMode |= LINK_MODE_ALL_ON;
+  else displayMode &= ~LINK_MODE_ALL_ON;
+
+  linkMode(displayMode);
+}
+
+uint16_t Arduboy2Core::displayErrors()
+{
+  return linkErrorCount;
+}
+
+DisplayCounts Arduboy2Core::displayCounts()
+{
+  DisplayCounts counts;
+
+#ifdef LINK_SPIM
+  NVIC_DisableIRQ(SPIM3_IRQn); // the events arrive as a frame is sent
+#endif
+  counts.good = linkCounts.good;
+  counts.bad = linkCounts.bad;
+  counts.lost = linkCounts.lost;
+#ifdef LINK_SPIM
+  NVIC_EnableIRQ(SPIM3_IRQn);
+#endif
+  return counts;
 }
 
 /* Buttons */
@@ -281,6 +1060,83 @@ uint8_t Arduboy2Core::buttonsState()
   return buttons;
 }
 
+uint16_t Arduboy2Core::pcmWrite(const int8_t *samples, uint16_t count)
+{
+  uint16_t space = PCM_BUFFER - pcmCount;
+
+  if (count > space) count = space;
+  for (uint16_t i = 0; i < count; i++)
+  {
+    pcmBuffer[(pcmFirst + pcmCount + i) % PCM_BUFFER] = samples[i];
+  }
+  pcmCount += count;
+
+  return count;
+}
+
+uint16_t Arduboy2Core::pcmWanted()
+{
+  uint16_t have = pcmLevel + pcmCount;
+
+  return (have < PCM_FIFO / 2) ? (PCM_FIFO / 2) - have : 0;
+}
+
+void Arduboy2Core::playScore(const uint8_t *score)
+{
+  scoreStart = score;
+  scoreVolumes = false;
+
+  // an optional header, "Pt", its length, then flags
+  if (pgm_read_byte(score) == 'P' && pgm_read_byte(score + 1) == 't')
+  {
+    scoreVolumes = pgm_read_byte(score + 3) & 0x80;
+    scoreStart += pgm_read_byte(score + 2);
+  }
+
+  scoreNext = scoreStart;
+  scoreDue = millis();
+}
+
+void Arduboy2Core::stopScore()
+{
+  scoreNext = NULL;
+  for (uint8_t channel = 0; channel < PSG_CHANNELS; channel++)
+  {
+    if (psgVoice[channel]) psgNoteOff(channel);
+  }
+}
+
+bool Arduboy2Core::scorePlaying()
+{
+  return scoreNext != NULL;
+}
+
+uint8_t Arduboy2Core::buttonsState(ButtonEvent events[], uint8_t &count)
+{
+  uint8_t n = 0;
+
+#ifdef LINK_SPIM
+  NVIC_DisableIRQ(SPIM3_IRQn); // events are added as a frame is sent
+#endif
+  while (n < count && buttonEventCount)
+  {
+    events[n++] = buttonEvents[buttonEventFirst];
+    buttonEventFirst = (buttonEventFirst + 1) % BUTTON_EVENTS;
+    buttonEventCount--;
+  }
+#ifdef LINK_SPIM
+  NVIC_EnableIRQ(SPIM3_IRQn);
+#endif
+  count = n;
+
+  return buttonsState();
+}
+
+uint16_t Arduboy2Core::buttonEventsLost()
+{
+  return buttonEventLosses;
+}
+
 // delay in ms with 16 bit duration
 void Arduboy2Core::delayShort(uint16_t ms)
 {
@@ -37,10 +37,49 @@
 #define UP_BUTTON    64 /**< The Up button value for functions requiring a bitmask */
 #define DOWN_BUTTON 128 /**< The Down button value for functions requiring a bitmask */
 
+#define BUTTON_EVENTS 8 /**< The number of button events kept by buttonsState() */
+
+/** \brief
+ * A change in the buttons, as returned by `buttonsState(ButtonEvent[], uint8_t&)`.
+ */
+struct ButtonEvent
+{
+  uint8_t buttons;    /**< The buttons held after the change, as `buttonsState()` */
+  unsigned long time; /**< The value of `millis()` when it happened, to within a few ms */
+};
+
+/** \brief
+ * The FPGA's counts of the frames it has received, as `displayCounts()`
+ * returns them.
+ */
+struct DisplayCounts
+{
+  uint16_t good; /**< Frames that passed their check and were shown */
+  uint16_t bad;  /**< Frames refused, for a failed check or after one */
+  uint16_t lost; /**< Frame numbers skipped, frames that never arrived */
+};
+
+/* FPGA link transport
+ *
+ * by default the screen is sent to the FPGA by toggling the wclk, d0 and d1
+ * pins in software. Defining LINK_SPIM instead builds each frame in RAM and
+ * has SPIM3 clock it out using EasyDMA, one bit per clock on d0, so the
+ * sketch keeps running during the transfer. The FPGA must then be built with
+ * SERIAL_LINK = 1 (see GBA.v).
+ *
+ * SPIM3 is then no longer available to the SPI library.
+ */
+// #define LINK_SPIM
+
+#if defined(LINK_SPIM) && !defined(LINK_SPIM_FREQUENCY)
+#define LINK_SPIM_FREQUENCY SPIM_FREQUENCY_FREQUENCY_M8 //< up to M32 for SPIM3
+#endif
+
 #define DC_BIT   0x40000000
 #define WCLK_BIT 0x10000000
 #define D1_BIT   0x08000000
 #define D0_BIT   0x04000000
+#define LINK_ERROR_BIT 0x00000100 // P0.08, driven by the FPGA (also the button events)
 
 #define WIDTH 128 /**< The width of the display in pixels */
 #define HEIGHT 64 /**< The height of the display in pixels */
@@ -48,6 +87,9 @@
 // Frequency value for sequence termination. (No duration follows)
 #define TONES_END 0x8000
 
+#define PCM_RATE 10512   /**< PCM samples played per second by the GBA */
+#define PCM_BUFFER 1024  /**< PCM samples waiting to be sent to the FPGA */
+
 #define NOTE_REST       0
 #define NOTE_C3         44
 #define NOTE_CS3        156
@@ -180,6 +222,41 @@ class Arduboy2Core
      */
     uint8_t static buttonsState();
 
+    /** \brief
+     * Get the current state of all buttons, and the changes to them since the
+     * last call.
+     *
+     * \param events An array to receive the changes, oldest first.
+     * \param count The size of `events` when called, and the number of
+     * changes returned in it on return.
+     *
+     * \return A bitmask of the state of all the buttons, as `buttonsState()`.
+     *
+     * \details
+     * The GBA samples its buttons about 1000 times a second, timing each
+     * sample, and the FPGA keeps the changes. They are read back over the link
+     * with each frame sent by `paintScreen()`, so a press and release between
+     * two frames isn't missed. Up to `BUTTON_EVENTS` changes are kept; if
+     * there are more the oldest are dropped.
+     *
+     * \see buttonEventsLost()
+     */
+    uint8_t static buttonsState(ButtonEvent events[], uint8_t &count);
+
+    /** \brief
+     * Get the number of times button changes have been lost.
+     *
+     * \return A count of the frames that found more than 8 changes waiting in
+     * the FPGA, which only sends the latest 8, plus the changes dropped
+     * because `buttonsState(ButtonEvent[], uint8_t&)` wasn't called before
+     * `BUTTON_EVENTS` were kept.
+     *
+     * \details
+     * The buttons returned are always the current ones, only the changes
+     * between are missing.
+     */
+    uint16_t static buttonEventsLost();
+
     /** \brief
      * Paints an entire image directly to the display from an array in RAM.
      *
@@ -200,19 +277,113 @@ class Arduboy2Core
      * If parameter `clear` is set to `true` the RAM array will be cleared to
      * zeros after its contents are written to the display.
      *
-     * \see paint8Pixels()
+     * The FPGA holds three copies of the image. Each frame is written in to
+     * the copy after the one being shown and then flipped to in one command,
+     * so a partly sent frame is never displayed. A copy of the image last
+     * sent to each of them is kept, and only the 16 pixel wide words of the
+     * FPGA's copy that differ from the new image are sent, each run of them
+     * with a one byte header saying how many words to skip or write.
+     *
+     * With `LINK_SPIM` defined the frame is copied out and sent in the
+     * background, so this returns before it has reached the FPGA and the
+     * image array can be changed straight away. It only waits when two
+     * earlier frames are still being sent. The default link is driven by the
+     * CPU toggling the pins, so then this returns once the frame has been
+     * sent.
+     *
+     * \see displayBusy() waitDisplay() paint8Pixels()
      */
     void static paintScreen(uint8_t image[], bool clear = false);
 
+    /** \brief
+     * Test if a frame is still being sent to the display.
+     *
+     * \return `true` if a frame passed to `paintScreen()` hasn't been
+     * completely sent yet.
+     *
+     * \details
+     * Only a `LINK_SPIM` build sends frames in the background. Otherwise this
+     * always returns `false`.
+     *
+     * \see waitDisplay() paintScreen()
+     */
+    bool static displayBusy();
+
+    /** \brief
+     * Wait until all frames have been sent to the display.
+     *
+     * \details
+     * Only a `LINK_SPIM` build sends frames in the background. Otherwise
+     * `paintScreen()` has already sent the frame, and this returns straight
+     * away.
+     *
+     * \see displayBusy() paintScreen()
+     */
+    void static waitDisplay();
+
+    /** \brief
+     * Get the number of times the FPGA has reported a bad frame.
+     *
+     * \return The number of calls to `paintScreen()` that found the FPGA's
+     * link error flag had been set at the end of an earlier frame.
+     *
+     * \details
+     * Each frame sent to the FPGA carries a frame number and a check of its
+     * data. A frame that fails the check isn't shown, and the FPGA then
+     * signals an error until a whole image has been received correctly.
+     * While it does, `paintScreen()` sends the entire image. A count that
+     * keeps rising means the link is being clocked too fast.
+     *
+     * \see displayCounts()
+     */
+    uint16_t static displayErrors();
+
+    /** \brief
+     * Get the FPGA's own counts of good, bad and lost frames.
+     *
+     * \return The counts as the FPGA sent them back with the button events
+     * at the start of the latest frame, so they don't yet include that
+     * frame.
+     *
+     * \details
+     * The counts are 16 bits and wrap. The GBA can also read them at
+     * cartridge addresses 0x0A001800 - 0x0A001805.
+     *
+     * \see displayErrors()
+     */
+    DisplayCounts static displayCounts();
+
     /** \brief
      * Blank the display screen by setting all pixels off.
      *
      * \details
      * All pixels on the screen will be written with a value of 0 to turn
-     * them off.
+     * them off. The FPGA clears its copy of the image itself, so only a
+     * couple of commands are sent.
      */
     void static blank();
 
+    /** \brief
+     * Invert the entire display or set it back to normal.
+     *
+     * \param inverse `true` will invert the display. `false` will set the
+     * display to no-inverted.
+     *
+     * \details
+     * Calling this function with a value of `true` will set the display to
+     * inverted mode. A pixel with a value of 0 will be on and a pixel set to 1
+     * will be off.
+     *
+     * Once in inverted mode, the display will remain this way
+     * until it is set back to non-inverted mode by calling this function with
+     * `false`.
+     *
+     * \note
+     * The FPGA applies this as the GBA reads the image, so it takes effect
+     * without the image being sent again.
+     */
+    void static invert(bool inverse);
+
     /** \brief
      * Turn all display pixels on or display the buffer contents.
      *
@@ -330,6 +501,75 @@ class Arduboy2Core
    */
   static void timer();
 
+  /** \brief
+   * Queue PCM samples to be played.
+   *
+   * \param samples 8 bit signed samples at `PCM_RATE`.
+   * \param count The number of samples.
+   *
+   * \return The number of samples queued, fewer than `count` if the buffer
+   * is full.
+   *
+   * \details
+   * The samples are sent to the FPGA with the frames sent by `paintScreen()`,
+   * in pairs, and played by the GBA's Direct Sound A alongside any tone. The
+   * GBA takes them at a steady rate from a FIFO of 1024 samples in the FPGA,
+   * so they play evenly whatever the frame rate. Call `pcmWanted()` once a
+   * frame to know how many to mix.
+   *
+   * \see pcmWanted()
+   */
+  static uint16_t pcmWrite(const int8_t *samples, uint16_t count);
+
+  /** \brief
+   * Get the number of PCM samples to queue now.
+   *
+   * \return The number of samples that would bring the FPGA's FIFO, less
+   * those already queued, up to half full.
+   *
+   * \details
+   * The FPGA reports the level of its FIFO with each frame, so mixing this
+   * many samples each frame keeps the sound going without the delay growing.
+   *
+   * \see pcmWrite()
+   */
+  static uint16_t pcmWanted();
+
+  /** \brief
+   * Play a score on the GBA's four PSG channels.
+   *
+   * \param score A score in the Playtune format, in program memory.
+   *
+   * \details
+   * Tracks 0 to 3 play on square 1, square 2, the wave channel and the noise
+   * channel. The score is read from where it is stored as it plays, so only
+   * a few bytes of RAM are used. Note volumes are used if the score has a
+   * "Pt" header saying they are present. Instrument changes are ignored.
+   *
+   * The score is stepped by `paintScreen()`, so notes start and stop on the
+   * frame after they are due. A tone started with `tone()` takes square 2
+   * while it plays.
+   *
+   * \see stopScore() scorePlaying()
+   */
+  static void playScore(const uint8_t *score);
+
+  /** \brief
+   * Stop the score being played and silence its channels.
+   *
+   * \see playScore()
+   */
+  static void stopScore();
+
+  /** \brief
+   * Test if a score is playing.
+   *
+   * \return `true` until the score ends or is stopped.
+   *
+   * \see playScore()
+   */
+  static bool scorePlaying();
+
   protected:
     // internals
     void static bootPins();
@@ -5,6 +5,7 @@
  */
 
 #include "Sprites.h"
+#include "SpritesBlit.h"
 
 void Sprites::drawExternalMask(int16_t x, int16_t y, const uint8_t *bitmap,
                                const uint8_t *mask, uint8_t frame, uint8_t mask_frame)
@@ -32,6 +33,222 @@ void Sprites::drawPlusMask(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t
   draw(x, y, bitmap, frame, NULL, 0, SPRITE_PLUS_MASK);
 }
 
+// The cache of shifted sprite frames. Each entry is a page row of bytes for
+// each row of the frame plus one, shifted down, then the same for its mask if
+// it has one. The entries' bytes are packed together at the start of the
+// buffer, in the order they were made.
+#define SPRITES_CACHE_ENTRIES 32
+// A frame at a shift is looked for, and made, in this many entries only, so a
+// miss costs little more than a hit
+#define SPRITES_CACHE_WAYS 4
+// An entry drawn within this many lookups isn't dropped to make room for
+// another, so a set of sprites too big for the cache doesn't keep replacing
+// itself
+#define SPRITES_CACHE_KEEP 64
+// A frame bigger than this share of the buffer isn't cached: its copies
+// would soon push each other out
+#define SPRITES_CACHE_SHARE 4
+// The cache is passed by after a window of lookups in which more than an
+// eighth missed with no room: shifting every draw is then quicker than a mix
+// of copies and shifts. It is tried again after a window, for a set of
+// sprites that has changed, then twice as many each time that fails too.
+#define SPRITES_CACHE_WINDOW 64
+#define SPRITES_CACHE_WAIT_MAX 128 // windows
+
+struct SpritesCacheEntry
+{
+  const uint8_t *bitmap; // the frame, NULL if the entry is unused
+  const uint8_t *mask;
+  uint8_t w;
+  uint8_t h;
+  uint8_t drawMode;
+  uint8_t shift;
+  uint16_t offset; // in the buffer
+  uint16_t size;
+  uint32_t used;   // cacheClock when last drawn
+};
+
+static uint8_t *cacheBuffer = NULL;
+static uint16_t cacheSize = 0;
+static uint16_t cacheEnd = 0; // bytes of the buffer in use
+static uint32_t cacheClock = 0;
+static uint32_t cacheKeepUntil = 0; // nothing can be dropped before then
+static uint8_t cacheFullMisses = 0; // in this window
+static uint16_t cachePassBy = 0; // lookups left to pass the cache by
+static uint8_t cacheWaitNext = 1; // windows, if the next one fails
+static SpritesCacheEntry cacheEntries[SPRITES_CACHE_ENTRIES];
+
+uint32_t Sprites::cacheHits = 0;
+uint32_t Sprites::cacheMisses = 0;
+
+void Sprites::setCache(uint8_t *buffer, uint16_t size)
+{
+  cacheBuffer = buffer;
+  cacheSize = buffer ? size : 0;
+  cacheEnd = 0;
+  cacheClock = 0;
+  cacheKeepUntil = 0;
+  cacheFullMisses = 0;
+  cachePassBy = 0;
+  cacheWaitNext = 1;
+  memset(cacheEntries, 0, sizeof(cacheEntries));
+  cacheHits = 0;
+  cacheMisses = 0;
+}
+
+// drop an entry, moving the bytes of those after it down
+static void cacheDrop(SpritesCacheEntry &dropped)
+{
+  uint16_t end = dropped.offset + dropped.size;
+
+  memmove(&cacheBuffer[dropped.offset], &cacheBuffer[end], cacheEnd - end);
+  for (uint8_t i = 0; i < SPRITES_CACHE_ENTRIES; i++) {
+    SpritesCacheEntry &entry = cacheEntries[i];
+
+    if (entry.bitmap && entry.offset > dropped.offset) {
+      entry.offset -= dropped.size;
+    }
+  }
+  cacheEnd -= dropped.size;
+  dropped.bitmap = NULL;
+}
+
+// false while the cache is passed by, the draw counted as a miss
+static inline bool cacheInUse()
+{
+  if (cachePassBy == 0)
+    return true;
+  cachePassBy--;
+  Sprites::cacheMisses++;
+  return false;
+}
+
+// Find the frame shifted down, making it if it isn't cached. Returns NULL if
+// it can't be cached.
+static const uint8_t *cacheFind(const uint8_t *bitmap, const uint8_t *mask,
+                                uint8_t w, uint8_t h, uint8_t drawMode,
+                                uint8_t shift)
+{
+  uint8_t rows = h / 8 + (h % 8 > 0 ? 1 : 0);
+  uint16_t plane = w * (rows + 1);
+  bool hasMask = drawMode != SPRITE_IS_MASK && drawMode != SPRITE_IS_MASK_ERASE;
+  uint16_t size = hasMask ? plane * 2 : plane;
+  uint8_t step = (drawMode == SPRITE_PLUS_MASK) ? 2 : 1;
+  SpritesCacheEntry *entry;
+
+  if (drawMode != SPRITE_UNMASKED && drawMode != SPRITE_MASKED &&
+      drawMode != SPRITE_PLUS_MASK && hasMask)
+    return NULL;
+
+  if (size > cacheSize / SPRITES_CACHE_SHARE) {
+    Sprites::cacheMisses++;
+    return NULL;
+  }
+
+  cacheClock++;
+  if (cacheClock % SPRITES_CACHE_WINDOW == 0) {
+    if (cacheFullMisses > SPRITES_CACHE_WINDOW / 8) {
+      cachePassBy = cacheWaitNext * SPRITES_CACHE_WINDOW;
+      if (cacheWaitNext < SPRITES_CACHE_WAIT_MAX)
+        cacheWaitNext *= 2;
+    } else {
+      cacheWaitNext = 1;
+    }
+    cacheFullMisses = 0;
+  }
+
+  // entries are looked for, and made, in the slots given by the frame and
+  // shift
+  uint8_t first = ((uintptr_t) bitmap ^ ((uintptr_t) bitmap >> 5) ^ (shift * 7));
+  SpritesCacheEntry *free = NULL;
+  SpritesCacheEntry *oldestWay = NULL;
+
+  for (uint8_t i = 0; i < SPRITES_CACHE_WAYS; i++) {
+    entry = &cacheEntries[(first + i) % SPRITES_CACHE_ENTRIES];
+    if (!entry->bitmap) {
+      if (!free) free = entry;
+    } else if (entry->bitmap == bitmap && entry->mask == mask &&
+               entry->w == w && entry->h == h &&
+               entry->drawMode == drawMode && entry->shift == shift) {
+      entry->used = cacheClock;
+      Sprites::cacheHits++;
+      return &cacheBuffer[entry->offset];
+    } else if (!oldestWay || entry->used < oldestWay->used) {
+      oldestWay = entry;
+    }
+  }
+
+  Sprites::cacheMisses++;
+  if (!free || cacheEnd + size > cacheSize) {
+    cacheFullMisses++;
+    if (cacheClock < cacheKeepUntil)
+      return NULL;
+  }
+
+  // make room: a slot from the oldest in its ways if none is free, then
+  // bytes from the entries used least recently
+  entry = free;
+  while (!entry || cacheEnd + size > cacheSize) {
+    SpritesCacheEntry *oldest = entry ? NULL : oldestWay;
+
+    if (entry) {
+      for (uint8_t i = 0; i < SPRITES_CACHE_ENTRIES; i++) {
+        SpritesCacheEntry *e = &cacheEntries[i];
+
+        if (e->bitmap && (!oldest || e->used < oldest->used))
+          oldest = e;
+      }
+    }
+    if (cacheClock - oldest->used < SPRITES_CACHE_KEEP) {
+      cacheKeepUntil = oldest->used + SPRITES_CACHE_KEEP;
+      return NULL;
+    }
+    cacheDrop(*oldest);
+    if (!entry)
+      entry = oldest;
+  }
+
+  entry->bitmap = bitmap;
+  entry->mask = mask;
+  entry->w = w;
+  entry->h = h;
+  entry->drawMode = drawMode;
+  entry->shift = shift;
+  entry->offset = cacheEnd;
+  entry->size = size;
+  entry->used = cacheClock;
+  cacheEnd += size;
+
+  // each byte is made from the bytes above and below the page boundary
+  uint8_t *image = &cacheBuffer[entry->offset];
+  for (uint8_t p = 0; p <= rows; p++) {
+    for (uint8_t c = 0; c < w; c++) {
+      uint16_t above = ((p - 1) * w + c) * step;
+      uint16_t below = (p * w + c) * step;
+      uint8_t imageAbove = (p > 0) ? pgm_read_byte(bitmap + above) : 0;
+      uint8_t imageBelow = (p < rows) ? pgm_read_byte(bitmap + below) : 0;
+
+      image[p * w + c] = (imageBelow << shift) | (imageAbove >> (8 - shift));
+      if (!hasMask)
+        continue;
+
+      uint8_t maskAbove = 0xFF, maskBelow = 0xFF; // SPRITE_UNMASKED
+      if (drawMode == SPRITE_MASKED) {
+        maskAbove = (p > 0) ? pgm_read_byte(mask + above) : 0;
+        maskBelow = (p < rows) ? pgm_read_byte(mask + below) : 0;
+      } else if (drawMode == SPRITE_PLUS_MASK) {
+        maskAbove = (p > 0) ? pgm_read_byte(bitmap + above + 1) : 0;
+        maskBelow = (p < rows) ? pgm_read_byte(bitmap + below + 1) : 0;
+      } else {
+        if (p == 0) maskAbove = 0;
+        if (p == rows) maskBelow = 0;
+      }
+      image[plane + p * w + c] = (maskBelow << shift) | (maskAbove >> (8 - shift));
+    }
+  }
+
+  return image;
+}
 
 //common functions
 void Sprites::draw(int16_t x, int16_t y,
@@ -80,7 +297,7 @@ void Sprites::drawBitmap(int16_t x, int16_t y,
 
   // xOffset technically doesn't need to be 16 bit but the math operations
   // are measurably faster if it is
-  uint16_t xOffset, ofs;
+  uint16_t xOffset;
   int8_t yOffset = y & 7;
   int8_t sRow = y / 8;
   uint8_t loop_h, start_h, rendered_width;
@@ -103,6 +320,33 @@ void Sprites::drawBitmap(int16_t x, int16_t y,
     rendered_width = (w - xOffset);
   }
 
+  // a shifted copy from the cache is drawn as rows on the pages, one more
+  // than the sprite has
+  if (yOffset != 0 && cacheBuffer != NULL && cacheInUse()) {
+    const uint8_t *shifted = cacheFind(bitmap, mask, w, h, draw_mode, yOffset);
+
+    if (shifted != NULL) {
+      uint8_t rows = h / 8 + (h % 8 > 0 ? 1 : 0) + 1;
+      const uint8_t *image = shifted + xOffset;
+      const uint8_t *shiftedMask = image + (w * rows);
+
+      if (draw_mode == SPRITE_IS_MASK) {
+        spritesBlit<SPRITES_BLIT_SET_IMAGE>
+          (Arduboy2Base::sBuffer, sRow, x + xOffset, 0, rows, image, NULL, w,
+           rendered_width);
+      } else if (draw_mode == SPRITE_IS_MASK_ERASE) {
+        spritesBlit<SPRITES_BLIT_CLEAR_IMAGE>
+          (Arduboy2Base::sBuffer, sRow, x + xOffset, 0, rows, image, NULL, w,
+           rendered_width);
+      } else {
+        spritesBlit<SPRITES_BLIT_CLEAR_MASK | SPRITES_BLIT_SET_IMAGE>
+          (Arduboy2Base::sBuffer, sRow, x + xOffset, 0, rows, image,
+           shiftedMask, w, rendered_width);
+      }
+      return;
+    }
+  }
+
   // if the top side of the render is offscreen skip those loops
   if (sRow < -1) {
     start_h = abs(sRow) - 1;
@@ -122,129 +366,43 @@ void Sprites::drawBitmap(int16_t x, int16_t y,
   loop_h -= start_h;
 
   sRow += start_h;
-  ofs = (sRow * WIDTH) + x + xOffset;
-  uint8_t *bofs = (uint8_t *)bitmap + (start_h * w) + xOffset;
-  uint8_t data;
-
-  uint8_t mul_amt = 1 << yOffset;
-  uint16_t mask_data;
-  uint16_t bitmap_data;
+  x += xOffset;
+  bitmap += (start_h * w) + xOffset;
 
+  // each mode has its own kernels, chosen by spritesBlit()
   switch (draw_mode) {
     case SPRITE_UNMASKED:
-      // we only want to mask the 8 bits of our own sprite, so we can
-      // calculate the mask before the start of the loop
-      mask_data = ~(0xFF * mul_amt);
-      // really if yOffset = 0 you have a faster case here that could be
-      // optimized
-      for (uint8_t a = 0; a < loop_h; a++) {
-        for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
-          bitmap_data = pgm_read_byte(bofs) * mul_amt;
-
-          if (sRow >= 0) {
-            data = Arduboy2Base::sBuffer[ofs];
-            data &= (uint8_t)(mask_data);
-            data |= (uint8_t)(bitmap_data);
-            Arduboy2Base::sBuffer[ofs] = data;
-          }
-          if (yOffset != 0 && sRow < 7) {
-            uint16_t index = (ofs + WIDTH);
-            data = Arduboy2Base::sBuffer[index];
-            data &= (*((unsigned char *) (&mask_data) + 1));
-            data |= (*((unsigned char *) (&bitmap_data) + 1));
-            Arduboy2Base::sBuffer[index] = data;
-          }
-          ofs++;
-          bofs++;
-        }
-        sRow++;
-        bofs += w - rendered_width;
-        ofs += WIDTH - rendered_width;
-      }
+      // clear the 8 bits of our own sprite and set the image's
+      spritesBlit<SPRITES_BLIT_CLEAR_ALL | SPRITES_BLIT_SET_IMAGE>
+        (Arduboy2Base::sBuffer, sRow, x, yOffset, loop_h, bitmap, NULL, w,
+         rendered_width);
       break;
 
     case SPRITE_IS_MASK:
-      for (uint8_t a = 0; a < loop_h; a++) {
-        for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
-          bitmap_data = pgm_read_byte(bofs) * mul_amt;
-          if (sRow >= 0) {
-            Arduboy2Base::sBuffer[ofs] |= (uint8_t)(bitmap_data);
-          }
-          if (yOffset != 0 && sRow < 7) {
-            uint16_t index = (ofs + WIDTH);
-            Arduboy2Base::sBuffer[index] &= ~(reinterpret_cast<const unsigned char *>(&bitmap_data)[1]);
-          }
-          ofs++;
-          bofs++;
-        }
-        sRow++;
-        bofs += w - rendered_width;
-        ofs += WIDTH - rendered_width;
-      }
+      spritesBlit<SPRITES_BLIT_SET_IMAGE>
+        (Arduboy2Base::sBuffer, sRow, x, yOffset, loop_h, bitmap, NULL, w,
+         rendered_width);
       break;
 
     case SPRITE_IS_MASK_ERASE:
-      for (uint8_t a = 0; a < loop_h; a++) {
-        for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
-          bitmap_data = pgm_read_byte(bofs) * mul_amt;
-          if (sRow >= 0) {
-            Arduboy2Base::sBuffer[ofs]  &= ~(uint8_t)(bitmap_data);
-          }
-          if (yOffset != 0 && sRow < 7) {
-            uint16_t index = (ofs + WIDTH);
-            Arduboy2Base::sBuffer[index] &= ~(reinterpret_cast<const unsigned char *>(&bitmap_data)[1]);
-          }
-          ofs++;
-          bofs++;
-        }
-        sRow++;
-        bofs += w - rendered_width;
-        ofs += WIDTH - rendered_width;
-      }
+      spritesBlit<SPRITES_BLIT_CLEAR_IMAGE>
+        (Arduboy2Base::sBuffer, sRow, x, yOffset, loop_h, bitmap, NULL, w,
+         rendered_width);
       break;
 
     case SPRITE_MASKED:
-      uint8_t *mask_ofs;
-      mask_ofs = (uint8_t *)mask + (start_h * w) + xOffset;
-      for (uint8_t a = 0; a < loop_h; a++) {
-        for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
-          // NOTE: you might think in the yOffset==0 case that this results
-          // in more effort, but in all my testing the compiler was forcing
-          // 16-bit math to happen here anyways, so this isn't actually
-          // compiling to more code than it otherwise would. If the offset
-          // is 0 the high part of the word will just never be used.
-
-          // load data and bit shift
-          // mask needs to be bit flipped
-          mask_data = ~(pgm_read_byte(mask_ofs) * mul_amt);
-          bitmap_data = pgm_read_byte(bofs) * mul_amt;
-
-          if (sRow >= 0) {
-            data = Arduboy2Base::sBuffer[ofs];
-            data &= (uint8_t)(mask_data);
-            data |= (uint8_t)(bitmap_data);
-            Arduboy2Base::sBuffer[ofs] = data;
-          }
-          if (yOffset != 0 && sRow < 7) {
-            uint16_t index = (ofs + WIDTH);
-            data = Arduboy2Base::sBuffer[index];
-            data &= (*((unsigned char *) (&mask_data) + 1));
-            data |= (*((unsigned char *) (&bitmap_data) + 1));
-            Arduboy2Base::sBuffer[index] = data;
-          }
-          ofs++;
-          mask_ofs++;
-          bofs++;
-        }
-        sRow++;
-        bofs += w - rendered_width;
-        mask_ofs += w - rendered_width;
-        ofs += WIDTH - rendered_width;
-      }
+      spritesBlit<SPRITES_BLIT_CLEAR_MASK | SPRITES_BLIT_SET_IMAGE>
+        (Arduboy2Base::sBuffer, sRow, x, yOffset, loop_h, bitmap,
+         mask + (start_h * w) + xOffset, w, rendered_width);
       break;
 
-
     case SPRITE_PLUS_MASK:
+      // the image and mask bytes are in pairs, so twice as far apart
+      bitmap += (start_h * w) + xOffset;
+      spritesBlit<SPRITES_BLIT_CLEAR_MASK | SPRITES_BLIT_SET_IMAGE |
+                  SPRITES_BLIT_PLUS_MASK>
+        (Arduboy2Base::sBuffer, sRow, x, yOffset, loop_h, bitmap, bitmap + 1,
+         w * 2, rendered_width);
       break;
   }
 }
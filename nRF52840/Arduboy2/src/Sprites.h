@@ -240,6 +240,56 @@ class Sprites
      */
     static void drawSelfMasked(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame);
 
+    /** \brief
+     * Give the sprite functions RAM to keep shifted copies of sprites in.
+     *
+     * \param buffer The RAM to use, or NULL to stop caching.
+     * \param size The size of the buffer in bytes.
+     *
+     * \details
+     * A sprite drawn at a Y coordinate that isn't a multiple of 8 has each of
+     * its bytes shifted in to two pages of the screen buffer. With a cache,
+     * the first draw of a frame at each of the 7 possible shifts makes a
+     * shifted copy of the frame and its mask. Later draws at that shift copy
+     * the cached bytes without shifting them. When the buffer is full, the
+     * copies used least recently are dropped to make room, unless they were
+     * drawn very recently, in which case the new draw isn't cached.
+     *
+     * A frame of `w` by `h` pixels takes `w * (h / 8 + 1)` bytes for each
+     * shift, twice that if it has a mask or is drawn with
+     * `drawOverwrite()`. A frame needing more than a quarter of the buffer
+     * isn't cached. The frames are assumed not to change while they are
+     * cached, so call this function again to empty the cache if one does.
+     *
+     * Shifting is already cheap, so the cache only pays when nearly every
+     * draw hits: a cached draw is about a fifth faster for a 16 by 16 sprite
+     * and twice as fast for 64 by 32. When the sprites and shifts in use
+     * don't fit, and draws keep missing, the cache is passed by for a while
+     * and every draw is shifted as it would be without one.
+     *
+     * \see cacheHits cacheMisses
+     */
+    static void setCache(uint8_t *buffer, uint16_t size);
+
+    /** \brief
+     * The number of draws that found their shifted copy in the cache.
+     *
+     * \details
+     * Together with `cacheMisses` this shows how well the cache size suits a
+     * game. Both are set to 0 by `setCache()`.
+     *
+     * \see setCache() cacheMisses
+     */
+    static uint32_t cacheHits;
+
+    /** \brief
+     * The number of draws that had to make their shifted copy, or that were
+     * too big to cache.
+     *
+     * \see setCache() cacheHits
+     */
+    static uint32_t cacheMisses;
+
     // Master function. Needs to be abstracted into separate function for
     // every render type.
     // (Not officially part of the API)
@@ -6,6 +6,7 @@
  */
 
 #include "SpritesB.h"
+#include "SpritesBlit.h"
 
 void SpritesB::drawExternalMask(int16_t x, int16_t y, const uint8_t *bitmap,
                                const uint8_t *mask, uint8_t frame, uint8_t mask_frame)
@@ -81,7 +82,7 @@ void SpritesB::drawBitmap(int16_t x, int16_t y,
 
   // xOffset technically doesn't need to be 16 bit but the math operations
   // are measurably faster if it is
-  uint16_t xOffset, ofs;
+  uint16_t xOffset;
   int8_t yOffset = y & 7;
   int8_t sRow = y / 8;
   uint8_t loop_h, start_h, rendered_width;
@@ -123,55 +124,28 @@ void SpritesB::drawBitmap(int16_t x, int16_t y,
   loop_h -= start_h;
 
   sRow += start_h;
-  ofs = (sRow * WIDTH) + x + xOffset;
-
-  uint8_t mul_amt = 1 << yOffset;
-  uint16_t mask_data;
-  uint16_t bitmap_data;
 
   const uint8_t ofs_step = draw_mode == SPRITE_PLUS_MASK ? 2 : 1;
-  const uint8_t ofs_stride = (w - rendered_width)*ofs_step;
   const uint16_t initial_bofs = ((start_h * w) + xOffset)*ofs_step;
 
   const uint8_t *bofs = bitmap + initial_bofs;
   const uint8_t *mask_ofs = !mask ? bitmap : mask;
   mask_ofs += initial_bofs + ofs_step - 1;
 
-  for (uint8_t a = 0; a < loop_h; a++) {
-    for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
-      uint8_t data;
-
-      bitmap_data = pgm_read_byte(bofs) * mul_amt;
-      mask_data = ~bitmap_data;
-
-      if (draw_mode == SPRITE_UNMASKED) {
-        mask_data = ~(0xFF * mul_amt);
-      } else if (draw_mode == SPRITE_IS_MASK_ERASE) {
-        bitmap_data = 0;
-      } else {
-        mask_data = ~(pgm_read_byte(mask_ofs) * mul_amt);
-      }
-
-      if (sRow >= 0) {
-        data = Arduboy2Base::sBuffer[ofs];
-        data &= (uint8_t)(mask_data);
-        data |= (uint8_t)(bitmap_data);
-        Arduboy2Base::sBuffer[ofs] = data;
-      }
-      if (yOffset != 0 && sRow < 7) {
-        uint16_t index = (ofs + WIDTH);
-        data = Arduboy2Base::sBuffer[index];
-        data &= (*((unsigned char *) (&mask_data) + 1));
-        data |= (*((unsigned char *) (&bitmap_data) + 1));
-        Arduboy2Base::sBuffer[index] = data;
-      }
-      ofs++;
-      mask_ofs += ofs_step;
-      bofs += ofs_step;
-    }
-    sRow++;
-    bofs += ofs_stride;
-    mask_ofs += ofs_stride;
-    ofs += WIDTH - rendered_width;
+  // one set of kernels for every mode
+  uint8_t op;
+
+  if (draw_mode == SPRITE_UNMASKED) {
+    op = SPRITES_BLIT_CLEAR_ALL | SPRITES_BLIT_SET_IMAGE;
+    mask_ofs = NULL;
+  } else if (draw_mode == SPRITE_IS_MASK_ERASE) {
+    op = SPRITES_BLIT_CLEAR_MASK;
+  } else {
+    op = SPRITES_BLIT_CLEAR_MASK | SPRITES_BLIT_SET_IMAGE;
   }
+  if (ofs_step == 2) op |= SPRITES_BLIT_PLUS_MASK;
+
+  spritesBlit<SPRITES_BLIT_ANY>(Arduboy2Base::sBuffer, sRow, x + xOffset,
+                                yOffset, loop_h, bofs, mask_ofs, w * ofs_step,
+                                rendered_width, op);
 }
@@ -0,0 +1,253 @@
+/**
+ * @file SpritesBlit.h
+ * \brief
+ * Word wide drawing of bitmap columns, for the sprite and bitmap functions.
+ */
+
+#ifndef SpritesBlit_h
+#define SpritesBlit_h
+
+#include <stdint.h>
+#include <string.h>
+#include "Arduboy2Core.h"
+
+// A row of a bitmap is a byte for each column, which lands shifted down in
+// one page of the screen buffer and, unless the shift is 0, partly in the
+// page below. Four columns are handled together as the bytes of a word, each
+// byte shifted in its own lane by masking off what crosses in to the next.
+//
+// What a draw does with each column's image byte and mask byte is an
+// operation made of these: the bits cleared are the image's, the mask's or
+// all of them, then the image's bits are set or inverted.
+#define SPRITES_BLIT_CLEAR_IMAGE 0x01
+#define SPRITES_BLIT_CLEAR_MASK  0x02
+#define SPRITES_BLIT_CLEAR_ALL   0x04
+#define SPRITES_BLIT_SET_IMAGE   0x08
+#define SPRITES_BLIT_FLIP_IMAGE  0x10
+#define SPRITES_BLIT_PLUS_MASK   0x20 // image and mask bytes in pairs
+// The operation is given at run time, in SpritesBlit, rather than compiled in
+// to the kernels. One set of kernels does every draw, for smaller code.
+#define SPRITES_BLIT_ANY         0x80
+
+struct SpritesBlit
+{
+  // lanes of all 0 or all 1 bits for each part of the operation, used by
+  // SPRITES_BLIT_ANY
+  uint32_t clearImage;
+  uint32_t clearMask;
+  uint32_t clearAll;
+  uint32_t setImage;
+  uint32_t flipImage;
+  uint8_t step;         // bytes from one column's image byte to the next
+  uint8_t shift;        // down the page, 0 to 7
+  uint32_t topLanes;    // bits of each lane in the top page
+  uint32_t bottomLanes; // and in the page below
+};
+
+static inline uint32_t spritesBlitLanes(uint8_t bits)
+{
+  return bits * 0x01010101UL;
+}
+
+static inline void spritesBlitBegin(SpritesBlit &blit, uint8_t op,
+                                    uint8_t shift)
+{
+  blit.clearImage = (op & SPRITES_BLIT_CLEAR_IMAGE) ? 0xFFFFFFFF : 0;
+  blit.clearMask = (op & SPRITES_BLIT_CLEAR_MASK) ? 0xFFFFFFFF : 0;
+  blit.clearAll = (op & SPRITES_BLIT_CLEAR_ALL) ? 0xFFFFFFFF : 0;
+  blit.setImage = (op & SPRITES_BLIT_SET_IMAGE) ? 0xFFFFFFFF : 0;
+  blit.flipImage = (op & SPRITES_BLIT_FLIP_IMAGE) ? 0xFFFFFFFF : 0;
+  blit.step = (op & SPRITES_BLIT_PLUS_MASK) ? 2 : 1;
+  blit.shift = shift;
+  blit.topLanes = spritesBlitLanes(0xFF << shift);
+  blit.bottomLanes = spritesBlitLanes(0xFF >> (8 - shift));
+}
+
+// four columns from every step'th byte
+static inline uint32_t spritesBlitLoad(const uint8_t *data, uint8_t step)
+{
+  uint32_t word;
+
+  if (step == 1)
+  {
+    memcpy(&word, data, 4); // a single load, aligned or not
+    return word;
+  }
+  return data[0] | (data[step] << 8) | (data[step * 2] << 16) |
+         ((uint32_t) data[step * 3] << 24);
+}
+
+static inline uint32_t spritesBlitApply(uint32_t dest, uint32_t clear,
+                                        uint32_t set, uint32_t flip)
+{
+  return ((dest & ~clear) | set) ^ flip;
+}
+
+// Draw one column, or four if word is true, in to the top page and the page
+// below where they are on the screen. The template arguments are constants,
+// so the compiler drops whatever the operation and pages don't need.
+template <uint8_t op, bool shifted, bool hasTop, bool hasBottom, bool word>
+static inline void spritesBlitColumns(const SpritesBlit &blit,
+                                      uint8_t *top, uint8_t *bottom,
+                                      const uint8_t *image, const uint8_t *mask,
+                                      uint8_t step)
+{
+  bool usesMask = (op == SPRITES_BLIT_ANY) ? (blit.clearMask != 0) :
+                  ((op & SPRITES_BLIT_CLEAR_MASK) != 0);
+  uint32_t i = word ? spritesBlitLoad(image, step) : *image;
+  uint32_t m = !usesMask ? 0 : word ? spritesBlitLoad(mask, step) : *mask;
+  uint32_t clear, set, flip;
+  uint32_t dest;
+
+  if (op == SPRITES_BLIT_ANY)
+  {
+    clear = (i & blit.clearImage) | (m & blit.clearMask) | blit.clearAll;
+    set = i & blit.setImage;
+    flip = i & blit.flipImage;
+  }
+  else
+  {
+    clear = ((op & SPRITES_BLIT_CLEAR_IMAGE) ? i : 0) |
+            ((op & SPRITES_BLIT_CLEAR_MASK) ? m : 0) |
+            ((op & SPRITES_BLIT_CLEAR_ALL) ? 0xFFFFFFFF : 0);
+    set = (op & SPRITES_BLIT_SET_IMAGE) ? i : 0;
+    flip = (op & SPRITES_BLIT_FLIP_IMAGE) ? i : 0;
+  }
+
+  if (hasTop)
+  {
+    if (word) memcpy(&dest, top, 4); else dest = *top;
+    if (shifted)
+    {
+      uint8_t s = blit.shift;
+      uint32_t lanes = blit.topLanes;
+
+      dest = spritesBlitApply(dest, (clear << s) & lanes, (set << s) & lanes,
+                              (flip << s) & lanes);
+    }
+    else
+    {
+      dest = spritesBlitApply(dest, clear, set, flip);
+    }
+    if (word) memcpy(top, &dest, 4); else *top = dest;
+  }
+  if (shifted && hasBottom)
+  {
+    uint8_t s = 8 - blit.shift;
+    uint32_t lanes = blit.bottomLanes;
+
+    if (word) memcpy(&dest, bottom, 4); else dest = *bottom;
+    dest = spritesBlitApply(dest, (clear >> s) & lanes, (set >> s) & lanes,
+                            (flip >> s) & lanes);
+    if (word) memcpy(bottom, &dest, 4); else *bottom = dest;
+  }
+}
+
+// Draw count columns of a bitmap row four at a time, the Cortex-M4 loading
+// and storing words at any address, then the last few a byte at a time.
+template <uint8_t op, bool shifted, bool hasTop, bool hasBottom>
+static inline void spritesBlitRow(const SpritesBlit &blit,
+                                  uint8_t *top, uint8_t *bottom,
+                                  const uint8_t *image, const uint8_t *mask,
+                                  uint8_t step, uint8_t count)
+{
+  uint8_t i = 0;
+
+  for (; i + 4 <= count; i += 4)
+  {
+    spritesBlitColumns<op, shifted, hasTop, hasBottom, true>
+      (blit, top + i, bottom + i, image + i * step, mask + i * step, step);
+  }
+  for (; i < count; i++)
+  {
+    spritesBlitColumns<op, shifted, hasTop, hasBottom, false>
+      (blit, top + i, bottom + i, image + i * step, mask + i * step, step);
+  }
+}
+
+// Draw rows of count columns, the first in to page row sRow at column x,
+// either of which is on the screen. stride is the bytes from one row of the
+// bitmap to the next. When the bitmap lies on page rows (shifted is false)
+// there is no page below, and when it is all on the screen (clipped is
+// false) no row has to be tested.
+template <uint8_t op, bool shifted, bool clipped>
+static void spritesBlitRows(const SpritesBlit &blit, uint8_t *buffer,
+                            int8_t sRow, uint8_t x, uint8_t rows,
+                            const uint8_t *image, const uint8_t *mask,
+                            uint16_t stride, uint8_t count)
+{
+  uint8_t step = (op == SPRITES_BLIT_ANY) ? blit.step :
+                 (op & SPRITES_BLIT_PLUS_MASK) ? 2 : 1;
+
+  for (uint8_t a = 0; a < rows; a++, sRow++)
+  {
+    uint8_t *top = buffer + (sRow * WIDTH) + x;
+    uint8_t *bottom = top + WIDTH;
+
+    if (!clipped || (sRow >= 0 && sRow < (HEIGHT / 8) - 1))
+      spritesBlitRow<op, shifted, true, true>(blit, top, bottom, image, mask,
+                                              step, count);
+    else if (sRow >= 0)
+      spritesBlitRow<op, shifted, true, false>(blit, top, bottom, image, mask,
+                                               step, count);
+    else
+      spritesBlitRow<op, shifted, false, true>(blit, top, bottom, image, mask,
+                                               step, count);
+
+    image += stride;
+    if (mask) mask += stride;
+  }
+}
+
+// Draw rows of a bitmap, the first in to page row sRow shifted down by
+// shift, with the kernel for its operation. The rows off the screen are
+// skipped, then it is chosen once whether the bitmap lies on page rows and
+// whether a row is partly off the screen. The columns, from x, must all be
+// on the screen.
+template <uint8_t op>
+static void spritesBlit(uint8_t *buffer, int16_t sRow, uint8_t x,
+                        uint8_t shift, uint8_t rows,
+                        const uint8_t *image, const uint8_t *mask,
+                        uint16_t stride, uint8_t count,
+                        uint8_t anyOp = SPRITES_BLIT_ANY)
+{
+  SpritesBlit blit;
+  int16_t first = shift ? -1 : 0; // the first row with any of it on the screen
+
+  if (sRow < first)
+  {
+    uint8_t skip = (first - sRow < rows) ? first - sRow : rows;
+
+    sRow += skip;
+    rows -= skip;
+    image += skip * stride;
+    if (mask) mask += skip * stride;
+  }
+  if (sRow >= (HEIGHT / 8) || rows == 0 || count == 0)
+    return;
+  if (sRow + rows > (HEIGHT / 8))
+    rows = (HEIGHT / 8) - sRow;
+
+  bool clipped = sRow < 0 || sRow + rows + (shift ? 1 : 0) > (HEIGHT / 8);
+
+  spritesBlitBegin(blit, (op == SPRITES_BLIT_ANY) ? anyOp : op, shift);
+
+  if (shift == 0)
+  {
+    // a row is never partly off the screen
+    spritesBlitRows<op, false, false>(blit, buffer, sRow, x, rows, image,
+                                      mask, stride, count);
+  }
+  else if (clipped)
+  {
+    spritesBlitRows<op, true, true>(blit, buffer, sRow, x, rows, image,
+                                    mask, stride, count);
+  }
+  else
+  {
+    spritesBlitRows<op, true, false>(blit, buffer, sRow, x, rows, image,
+                                     mask, stride, count);
+  }
+}
+
+#endif